@@ -2,10 +2,87 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/stat.h>
 #include <dbus/dbus.h>
 #include "dbus.h"
+#include "dbus_private.h"
 
 
+#define DBUS_SEND_RETRY_DELAY	1		// ڴͨʱȴշȡߵļ룩
+
+
+////////////////////////////////////////////////////////////
+// ܣӵߣʧʱָ˱
+// 룺Ϣṹ
+// ʧʱĴϢ
+// أD-BusӣNULL-ʧ
+////////////////////////////////////////////////////////////
+DBusConnection* dbus_connect_bus(DBusError* error)
+{
+	int delay = DBUS_RECONNECT_DELAY;
+	int attempt;
+
+	for (attempt = 1; ; attempt++) {
+		// 1.ȡӣ󻺴ӿѶϿ
+		DBusConnection* connection = dbus_bus_get(DBUS_BUS_SESSION, error);
+		if (connection) {
+			dbus_connection_set_exit_on_disconnect(connection, FALSE);
+			if (dbus_connection_get_is_connected(connection)) {
+				return connection;
+			}
+
+			// Ϣʹlibdbus
+			while (dbus_connection_dispatch(connection) == DBUS_DISPATCH_DATA_REMAINS);
+			dbus_connection_unref(connection);
+		}
+		if (attempt >= DBUS_CONNECT_ATTEMPTS) {
+			return NULL;
+		}
+
+		// 2.˱ܺ
+		if (dbus_error_is_set(error)) {
+			dbus_error_free(error);
+		}
+		usleep(delay * 1000);
+		delay = delay * 2 < DBUS_RECONNECT_DELAY_MAX ? delay * 2 : DBUS_RECONNECT_DELAY_MAX;
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׷ӵD-BusϢ
+// 룺D-BusϢϢݽṹ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_append_data(DBusMessage* message, DBUS_DATA data)
+{
+	DBusMessageIter iter;
+	dbus_message_iter_init_append(message, &iter);
+
+	// Ϣ׷ӵϢĩβֵַʱѹ
+	int value_int;
+
+	switch (data.type) {
+	case DBUS_DATA_TYPE_STRING:
+		return dbus_append_string(&iter, data.value);
+	case DBUS_DATA_TYPE_INT32:
+		value_int = atoi(data.value);
+		if (!dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &value_int)) {
+			printf("Message Append Error: Out of Memory\n");
+			return -1;
+		}
+		return 0;
+	default:
+		printf("Error: Unknown Argument Type\n");
+		return -1;
+	}
+}
+
 ////////////////////////////////////////////////////////////
 // ܣϢָ
 // 룺ͷݽṹշݽṹϢݽṹ
@@ -19,7 +96,7 @@ int dbus_send_signal(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DBUS_DA
 	dbus_error_init(&error);     
     
 	// 2.ӵ
-	DBusConnection* connection = dbus_bus_get(DBUS_BUS_SESSION, &error);    
+	DBusConnection* connection = dbus_connect_bus(&error);    
 	if (!connection) {        
 		if (dbus_error_is_set(&error)) {            
 			printf("Connect Bus Error: %s\n", error.message);
@@ -28,8 +105,8 @@ int dbus_send_signal(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DBUS_DA
 		return -1;    
 	}     
 	
-	// 3.Ϊע
-	int ret = dbus_bus_request_name(connection, sender.bus_name, DBUS_NAME_FLAG_REPLACE_EXISTING, &error);    
+	// 3.Ϊעƣbus_nameΪNULLʱֻʹΨһƣʡȥһ
+	int ret = sender.bus_name ? dbus_bus_request_name(connection, sender.bus_name, DBUS_NAME_FLAG_REPLACE_EXISTING, &error) : DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER;
 	if (ret != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {        
 		if (dbus_error_is_set(&error)) {            
 			printf("Connection Name Error: %s\n", error.message);
@@ -38,53 +115,39 @@ int dbus_send_signal(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DBUS_DA
 		return -1;
 	}      
 
-	// 4.ȡϢԼ
-	int type;
-	void* value;
-	char* value_str;
-	int value_int;
+	// 4.D-BusϢ
+	DBUS_TRACE trace;
+	dbus_trace_begin(&trace);
 
-	switch (data.type) {
-	case DBUS_DATA_TYPE_STRING:
-		type = DBUS_TYPE_STRING;        
-		value_str = data.value;
-		value = &value_str;
-		break;
-	case DBUS_DATA_TYPE_INT32:
-		type = DBUS_TYPE_INT32;        
-		value_int = atoi(data.value);
-		value = &value_int;
-		break;
-	default:
-		printf("Error: Unknown Argument Type\n");   
-		return -1;
-	}    
-	 
-	// 5.D-BusϢ
 	DBusMessage* message = dbus_message_new_signal(receiver.object_path, receiver.interface_name, receiver.member_name);
 	if (!message) {
 		printf("Error: Signal Message NULL\n");
 		return -1;        
 	}         
 
-	// 6.D-BusϢ
-	DBusMessageIter iter;	
-	dbus_message_iter_init_append(message, &iter);
-	if (!dbus_message_iter_append_basic(&iter, type, value)) {
-		printf("Message Append Error: Out of Memory\n");  
+	// 5.D-BusϢʱĩβ׷Ӹٲ
+	if (dbus_append_data(message, data)) {
 		dbus_message_unref(message);
 		return -1;        
 	}         
+	dbus_trace_mark(&trace, "marshal");
+	if (dbus_trace_append(message, &trace)) {
+		dbus_message_unref(message);
+		return -1;
+	}
 	
-	// 7.D-BusϢ
+	// 6.D-BusϢ
 	dbus_uint32_t serial;
 	if (!dbus_connection_send(connection, message, &serial)) {
 		printf("Signal Send Error: Out of Memory\n");            
 		dbus_message_unref(message);
 		return -1;
 	}
+	dbus_trace_mark(&trace, "send");
 	dbus_connection_flush(connection);    
+	dbus_trace_mark(&trace, "flush");
 	dbus_message_unref(message);
+	dbus_trace_write(&trace, receiver.member_name);
 
 	printf("Signal Sent\n");
 	return 0;
@@ -103,7 +166,7 @@ int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DB
 	dbus_error_init(&error);     
     
 	// 2.ӵ
-	DBusConnection* connection = dbus_bus_get(DBUS_BUS_SESSION, &error);    
+	DBusConnection* connection = dbus_connect_bus(&error);    
 	if (!connection) {        
 		if (dbus_error_is_set(&error)) {            
 			printf("Connection Bus Error: %s\n", error.message);
@@ -112,8 +175,8 @@ int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DB
 		return -1;    
 	}     
 	
-	// 3.Ϊע
-	int ret = dbus_bus_request_name(connection, sender.bus_name, DBUS_NAME_FLAG_REPLACE_EXISTING, &error);    
+	// 3.Ϊעƣbus_nameΪNULLʱֻʹΨһƣʡȥһ
+	int ret = sender.bus_name ? dbus_bus_request_name(connection, sender.bus_name, DBUS_NAME_FLAG_REPLACE_EXISTING, &error) : DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER;
 	if (ret != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {        
 		if (dbus_error_is_set(&error)) {            
 			printf("Set Connection Name Error: %s\n", error.message);
@@ -122,45 +185,28 @@ int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DB
 		return -1;    
 	}      
 
-	// 4.ȡϢԼ
-	int type;
-	void* value;
-	char* value_str;
-	int value_int;
+	// 4.D-BusϢ
+	DBUS_TRACE trace;
+	dbus_trace_begin(&trace);
 
-	switch (data.type) {
-	case DBUS_DATA_TYPE_STRING:
-		type = DBUS_TYPE_STRING;
-		value_str = data.value;
-		value = &value_str;
-		break;
-	case DBUS_DATA_TYPE_INT32:
-		type = DBUS_TYPE_INT32;
-		value_int = atoi(data.value);
-		value = &value_int;
-		break;
-	default:
-		printf("Error: Unknown Argument Type\n");
-		return -1;
-	}   
-	
-	// 5.D-BusϢ
 	DBusMessage* message = dbus_message_new_method_call(receiver.bus_name, receiver.object_path, receiver.interface_name, receiver.member_name);
 	if (!message) {
 		printf("Error: Method Call Message NULL\n");
 		return -1;
 	}         
 	
-	// 6.D-BusϢ
-	DBusMessageIter iter;
-	dbus_message_iter_init_append(message, &iter);
-	if (!dbus_message_iter_append_basic(&iter, type, value)) {
-		printf("Message Append Error: Out of Memory\n");
+	// 5.D-BusϢʱĩβ׷Ӹٲ
+	if (dbus_append_data(message, data)) {
 		dbus_message_unref(message);
 		return -1;
 	}         
+	dbus_trace_mark(&trace, "marshal");
+	if (dbus_trace_append(message, &trace)) {
+		dbus_message_unref(message);
+		return -1;
+	}
 	
-	// 7.D-BusϢȴ
+	// 6.D-BusϢȴ
 	DBusPendingCall* pending;
 	if (!dbus_connection_send_with_reply(connection, message, &pending, DBUS_TIMEOUT_USE_DEFAULT)) {
 		printf("Method Call Send Error: Out of Memory\n");
@@ -172,10 +218,12 @@ int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DB
 		dbus_message_unref(message);
 		return -1;
 	}         
+	dbus_trace_mark(&trace, "send_with_reply");
 	dbus_connection_flush(connection);
+	dbus_trace_mark(&trace, "flush");
 	dbus_message_unref(message);
 	
-	// 8.ȴȡ
+	// 7.ȴȡ
 	dbus_pending_call_block(pending);              
 	message = dbus_pending_call_steal_reply(pending);
 	dbus_pending_call_unref(pending);
@@ -183,8 +231,10 @@ int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DB
 		printf("Error: Reply Null\n");
 		return -1;
 	}         
+	dbus_trace_mark(&trace, "reply");
     
-	// 9.ȡϢ
+	// 8.ȡϢ
+	DBusMessageIter iter;
 	if (!dbus_message_iter_init(message, &iter)) {
 		printf("Error: Message Has No Argument\n");
 		dbus_message_unref(message);
@@ -192,6 +242,8 @@ int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DB
 	}         
 	
 	pid_t pid = getpid();
+	char* value_str;
+	int value_int;
 
 	do {    
 		ret = dbus_message_iter_get_arg_type(&iter);
@@ -204,199 +256,626 @@ int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DB
 			dbus_message_iter_get_basic(&iter, &value_int);
 			printf("[%d] Got Method Return INT32: %d\n", pid, value_int);
 			break;
+		case DBUS_TYPE_STRUCT:
+			if (dbus_trace_is_header(&iter)) {
+				break;
+			}
+			value_str = dbus_decompress_string(&iter, NULL);
+			if (value_str) {
+				printf("[%d] Got Method Return STRING: %s\n", pid, value_str);
+				free(value_str);
+			}
+			break;
 		default:
 			printf("Error: Unkown Argument Type\n");
 			break;
 		}
 	} while (dbus_message_iter_next(&iter));
 	
+	// 9.ϲշ¼Ľ׶Σдļ
+	if (trace.id) {
+		DBUS_TRACE remote;
+		if (!dbus_trace_extract(message, &remote)) {
+			dbus_trace_merge(&trace, &remote);
+		}
+		dbus_trace_mark(&trace, "demarshal");
+		dbus_trace_write(&trace, receiver.member_name);
+	}
+
 	dbus_message_unref(message);
 	return 0;
 }
 
 ////////////////////////////////////////////////////////////
-// ܣԶ̺÷
-// 룺D-BusӣD-BusϢ
+// ܣͨͶͬźţȫд
+//       ڴͨʱȴշȡߣDBUS_DRAIN_TIMEOUT
+// 룺ͷݽṹշݽṹϢݽṹʹDBUS_SEND_FLAG_*
 // 
 // أ0-ɹ -1-ʧ
 ////////////////////////////////////////////////////////////
-int dbus_reply_method_call(DBusConnection* connection, DBusMessage* message)
+int dbus_send_signals(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DBUS_DATA data, int count, int flags)
 {
-	// 1.ڷD-BusϢ
-	DBusMessage* reply = dbus_message_new_method_return(message);
-	if (!reply) {
+	// 1.ӵߣֻͣϢɸѡ
+	DBUS_APPLICATION self;
+	memset(&self, 0, sizeof(self));
+	self.bus_name = sender.bus_name;
+
+	DBUS_CONTEXT* context = dbus_context_open(self, 0);
+	if (!context) {
+		return -1;
+	}
+
+	// 2.ڴͨʧʱȫD-Bus
+	if ((flags & DBUS_SEND_FLAG_SHM) && !dbus_context_open_shm(context, receiver)) {
+		printf("[%d] Shared Memory Channel Opened: %s\n", getpid(), receiver.bus_name);
+	}
+
+	// 3.ϲ߹ڴͨźŲϲ
+	if (flags & DBUS_SEND_FLAG_BATCH) {
+		DBUS_BATCH_POLICY policy;
+		policy.window = DBUS_BATCH_WINDOW;
+		policy.events = DBUS_BATCH_EVENTS;
+		policy.bytes = DBUS_BATCH_BYTES;
+		dbus_context_set_batch_policy(context, policy);
+	}
+
+	// 4.ͣͨʱԺ
+	long long start = dbus_monotonic_ms();
+	long long deadline = 0;
+	int ret = 0;
+	int sent;
+	for (sent = 0; sent < count; sent++) {
+		ret = dbus_context_send_signal(context, receiver, data);
+		if (ret == DBUS_SEND_RETRY) {
+			long long now = dbus_monotonic_ms();
+			if (!deadline) {
+				deadline = now + DBUS_DRAIN_TIMEOUT;
+			}
+			else if (now >= deadline) {
+				printf("Error: Shared Memory Channel Full\n");
+				ret = -1;
+				break;
+			}
+			usleep(DBUS_SEND_RETRY_DELAY * 1000);
+			sent--;
+			continue;
+		}
+		if (ret) {
+			break;
+		}
+		deadline = 0;
+	}
+
+	// 5.رʱδŷⲢдͶ
+	dbus_context_close(context);
+	long long elapsed = dbus_monotonic_ms() - start;
+	printf("[%d] %d Signals Sent in %lld ms\n", getpid(), sent, elapsed);
+
+	return ret ? -1 : 0;
+}
+
+typedef struct _DBUS_STREAM_SOURCE
+{
+	DBUS_CONTEXT* context;
+	int fd;					// ȡļ
+	char* buffer;			// Ѷȡδյ
+	size_t pending;
+	size_t position;
+	int status;				// 0- -1-ʧ
+}DBUS_STREAM_SOURCE;
+
+////////////////////////////////////////////////////////////
+// ܣпλʱļȡдر
+// 룺ļԴ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_send_stream_fill(DBUS_STREAM* stream, DBUS_STREAM_SOURCE* source)
+{
+	while (1) {
+		// 1.ϴδյȡļĩβʱر
+		if (!source->pending) {
+			ssize_t ret = read(source->fd, source->buffer, DBUS_STREAM_CHUNK);
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret < 0) {
+				printf("Error: Read Failed: %s\n", strerror(errno));
+			}
+			if (ret <= 0) {
+				dbus_stream_close(stream);
+				return;
+			}
+			source->pending = ret;
+			source->position = 0;
+		}
+
+		// 2.дʱȴһλص
+		long accepted = dbus_stream_write(stream, source->buffer + source->position, source->pending);
+		if (accepted <= 0) {
+			return;
+		}
+		source->position += accepted;
+		source->pending -= accepted;
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣļĻصд룬ڽʱ˳¼ѭ
+// 룺¼ļԴ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_send_stream_event(DBUS_STREAM* stream, int event, void* user_data)
+{
+	DBUS_STREAM_SOURCE* source = user_data;
+
+	switch (event) {
+	case DBUS_STREAM_EVENT_WRITABLE:
+		dbus_send_stream_fill(stream, source);
+		break;
+	case DBUS_STREAM_EVENT_DONE:
+		source->status = 0;
+		dbus_context_quit(source->context);
+		break;
+	default:
+		source->status = -1;
+		dbus_context_quit(source->context);
+		break;
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣʽļշȷȫݣ
+//       շļĿ¼
+// 룺ͷݽṹշݽṹļ·
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_send_stream(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, const char* path)
+{
+	// 1.ļ
+	DBUS_STREAM_SOURCE source;
+	memset(&source, 0, sizeof(source));
+	source.status = -1;
+
+	source.fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (source.fd < 0) {
+		printf("Error: Open %s Failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+	struct stat st;
+	if (fstat(source.fd, &st) || !S_ISREG(st.st_mode)) {
+		printf("Error: %s Is Not a Regular File\n", path);
+		close(source.fd);
+		return -1;
+	}
+	source.buffer = malloc(DBUS_STREAM_CHUNK);
+	if (!source.buffer) {
 		printf("Error: Out of Memory\n");
+		close(source.fd);
 		return -1;
 	}
 
-	// 2.ȡϢ
-	DBusMessageIter message_iter;
-	if (!dbus_message_iter_init(message, &message_iter)) {
-		printf("Error: Message Has No Argument\n");
+	// 2.ӵߣֻͣϢɸѡ
+	DBUS_APPLICATION self;
+	memset(&self, 0, sizeof(self));
+	self.bus_name = sender.bus_name;
+
+	source.context = dbus_context_open(self, 0);
+	if (!source.context) {
+		free(source.buffer);
+		close(source.fd);
 		return -1;
 	}
 
-	// 3.Ϣݣ	
-	DBusMessageIter reply_iter;
-	dbus_message_iter_init_append(reply, &reply_iter);
+	// 3.дһݣ֮ȷϻص
+	const char* name = strrchr(path, '/');
+	name = name ? name + 1 : path;
 
-	pid_t pid = getpid();
-	void* value;
-	char* value_str;
-	int value_int;
+	long long start = dbus_monotonic_ms();
+	DBUS_STREAM* stream = dbus_stream_open(source.context, receiver, name, st.st_size, dbus_send_stream_event, &source);
+	if (stream) {
+		dbus_send_stream_fill(stream, &source);
+		dbus_context_run(source.context);
+	}
 
-	do {
-		int ret = dbus_message_iter_get_arg_type(&message_iter);
-		switch (ret) {
-		case DBUS_TYPE_STRING:
-			dbus_message_iter_get_basic(&message_iter, &value_str);
-			printf("[%d] Got Method Call Argument STRING: %s\n", pid, value_str);
+	// 4.
+	long long elapsed = dbus_monotonic_ms() - start;
+	if (!source.status) {
+		printf("[%d] Stream Sent: %lld Bytes in %lld ms (%.1f MB/s)\n", getpid(), (long long)st.st_size, elapsed,
+			elapsed ? st.st_size / 1048576.0 * 1000 / elapsed : 0.0);
+	}
+	else {
+		printf("Error: Stream %s Failed\n", name);
+	}
 
-			// ݴ
-			// ......
+	dbus_context_close(source.context);
+	free(source.buffer);
+	close(source.fd);
+	return source.status;
+}
 
-			value = &value_str;
-			if (!dbus_message_iter_append_basic(&reply_iter, DBUS_TYPE_STRING, value)) {
-				printf("Error: Out of Memory\n");
-				dbus_message_unref(reply);
-				return -1;
-			}
-			break;
-		case DBUS_TYPE_INT32:		
-			dbus_message_iter_get_basic(&message_iter, &value_int);
-			printf("[%d] Got Method Call Argument INT32: %d\n", pid, value_int);
+////////////////////////////////////////////////////////////
+// ܣԶ̺÷Яٲʱдؽշ¼Ľ׶Σ
+// 룺D-BusӣD-BusϢͼټ¼
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_reply_method_call(DBusConnection* connection, DBusMessage* message, const DBUS_ARGS* args, DBUS_TRACE* trace)
+{
+	// 1.Ϣ
+	if (!args->count) {
+		printf("Error: Message Has No Argument\n");
+		return -1;
+	}
 
-			// ݴ
-			// ......
+	// 2.ڷD-BusϢ
+	DBusMessage* reply = dbus_message_new_method_return(message);
+	if (!reply) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
 
-			value = &value_int;
-			if (!dbus_message_iter_append_basic(&reply_iter, DBUS_TYPE_INT32, value)) {
-				printf("Error: Out of Memory\n");
-				dbus_message_unref(reply);
-				return -1;
-			}
-			break;
-		default:
-			printf("Error: Unknown Argument Type\n");
-			break;
+	// 3.Ϣݣ
+	pid_t pid = getpid();
+	int i;
+
+	for (i = 0; i < args->count; i++) {
+		DBUS_DATA data = args->data[i];
+		printf("[%d] Got Method Call Argument %s: %s\n", pid, data.type == DBUS_DATA_TYPE_INT32 ? "INT32" : "STRING", data.value);
+
+		// ݴ
+		// ......
+
+		if (dbus_append_data(reply, data)) {
+			dbus_message_unref(reply);
+			return -1;
 		}
+	}
 
-	} while (dbus_message_iter_next(&message_iter));
+	// 4.ظټ¼
+	dbus_trace_mark(trace, "handler");
+	if (dbus_trace_append(reply, trace)) {
+		dbus_message_unref(reply);
+		return -1;
+	}
 
-	// 5.ͷϢ
+	// 5.ͷϢ¼ѭд
 	dbus_uint32_t serial;
 	if (!dbus_connection_send(connection, reply, &serial)) {
 		printf("Error: Out of Memory\n");
 		dbus_message_unref(reply);
 		return -1;
 	}
-	dbus_connection_flush(connection);
 	dbus_message_unref(reply);
+	dbus_trace_mark(trace, "reply_send");
+	dbus_trace_write(trace, DBUS_MEMBER_METHOD);
 
 	return 0;
 }
 
 ////////////////////////////////////////////////////////////
-// ܣѭϢ
-// 룺շݽṹ
+// ܣźݴD-Busź빲ڴͨã
+// 룺D-BusģϢݽṹ
 // 
-// أ0-ɹ -1-ʧ
+// أ
 ////////////////////////////////////////////////////////////
-int dbus_receive(DBUS_APPLICATION self)
+void dbus_handle_signal(DBUS_CONTEXT* context, DBUS_DATA data)
 {
-	// 1.ʼϢṹ
-	DBusError error;
-	dbus_error_init(&error);
+	pid_t pid = getpid();
+	(void)context;
 
-	// 2.ӵ
-	DBusConnection* connection = dbus_bus_get(DBUS_BUS_SESSION, &error);
-	if (!connection) {
-		if (dbus_error_is_set(&error)) {
-			printf("Connect Bus Error: %s\n", error.message);
-			dbus_error_free(&error);
-		}
-		return -1;
+	switch (data.type) {
+	case DBUS_DATA_TYPE_STRING:
+		printf("[%d] Got Signal With STRING: %s\n", pid, data.value);
+		break;
+	case DBUS_DATA_TYPE_INT32:
+		printf("[%d] Got Signal With INT32: %s\n", pid, data.value);
+		break;
+	default:
+		printf("Error: Unkown Argument Type\n");
+		break;
 	}
 
-	// 3.Ϊע
-	int ret = dbus_bus_request_name(connection, self.bus_name, DBUS_NAME_FLAG_REPLACE_EXISTING, &error);
-	if (ret != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
-		if (dbus_error_is_set(&error)) {
-			printf("Connection Name Error: %s\n", error.message);
-			dbus_error_free(&error);
-		}
-		return -1;
-	}
+	// ݴ
+	// ......
+}
 
-	// 4.Ϣʽɸѡ
-	char rule[128];
-	snprintf(rule, sizeof(rule), DBUS_SIGNAL_RULE, self.interface_name);
-	dbus_bus_add_match(connection, rule, &error);
-	if (dbus_error_is_set(&error)) {
-		printf("Match Error: %s\n", error.message);
-		dbus_error_free(&error);
+////////////////////////////////////////////////////////////
+// ܣźŷ⣬¼뵥źͬ
+// 룺D-BusģD-BusϢ
+// 
+// أ¼-1-ʽ
+////////////////////////////////////////////////////////////
+static int dbus_process_batch(DBUS_CONTEXT* context, DBusMessage* message)
+{
+	// 1.Уŷǩ
+	if (!dbus_message_has_signature(message, DBUS_BATCH_SIGNATURE)) {
+		printf("Error: Unknown Argument Type\n");
 		return -1;
 	}
-	dbus_connection_flush(connection);
 
-	// 5.Ϣѭ
-	DBusMessage* message;
+	// 2.¼
 	DBusMessageIter iter;
-	const char* path;
+	DBusMessageIter array_iter;
+	DBusMessageIter struct_iter;
+	DBusMessageIter variant_iter;
+	DBUS_DATA data;
+	char buffer[16];
+	const char* member;
 	char* value_str;
 	int value_int;
+	int count = 0;
 
-	while (1) {
-		// 5.1.ȡϢ
-		dbus_connection_read_write(connection, 0);
-		message = dbus_connection_pop_message(connection);
-		if (!message) {
-			sleep(1);
+	dbus_message_iter_init(message, &iter);
+	dbus_message_iter_recurse(&iter, &array_iter);
+
+	while (dbus_message_iter_get_arg_type(&array_iter) == DBUS_TYPE_STRUCT) {
+		dbus_message_iter_recurse(&array_iter, &struct_iter);
+		dbus_message_iter_get_basic(&struct_iter, &member);
+		dbus_message_iter_next(&struct_iter);
+		dbus_message_iter_recurse(&struct_iter, &variant_iter);
+		dbus_message_iter_next(&array_iter);
+
+		switch (dbus_message_iter_get_arg_type(&variant_iter)) {
+		case DBUS_TYPE_STRING:
+			dbus_message_iter_get_basic(&variant_iter, &value_str);
+			data.type = DBUS_DATA_TYPE_STRING;
+			data.value = value_str;
+			break;
+		case DBUS_TYPE_INT32:
+			dbus_message_iter_get_basic(&variant_iter, &value_int);
+			snprintf(buffer, sizeof(buffer), "%d", value_int);
+			data.type = DBUS_DATA_TYPE_INT32;
+			data.value = buffer;
+			break;
+		default:
+			printf("Error: Unkown Argument Type\n");
 			continue;
 		}
 
-		// 5.2.ȶϢĿַ
-		path = dbus_message_get_path(message);
-		if (strcmp(path, self.object_path)) {
-			dbus_message_unref(message);
+		if (strcmp(member, DBUS_MEMBER_SIGNAL)) {
+			printf("Error: Unkown Message Type\n");
 			continue;
 		}
+		dbus_handle_signal(context, data);
+		count++;
+	}
+
+	return count;
+}
 
-		// 5.3.Ϣݴ
-		pid_t pid = getpid();
-		do {
-			if (dbus_message_is_signal(message, self.interface_name, DBUS_MEMBER_SIGNAL)) {
-
-				if (!dbus_message_iter_init(message, &iter)) {
-					printf("Error: Message Has No Argument\n");
-					break;
-				}
-
-				ret = dbus_message_iter_get_arg_type(&iter);
-				switch (ret) {
-				case DBUS_TYPE_STRING:
-					dbus_message_iter_get_basic(&iter, &value_str);
-					printf("[%d] Got Signal With STRING: %s\n", pid, value_str);
-					break;
-				case DBUS_TYPE_INT32:
-					dbus_message_iter_get_basic(&iter, &value_int);
-					printf("[%d] Got Signal With INT32: %d\n", pid, value_int);
-					break;
-				default:
-					printf("Error: Unkown Argument Type\n");
-					break;
-				}
+////////////////////////////////////////////////////////////
+// ܣһյϢ
+// 룺D-BusģD-BusϢ
+// 
+// أ0-Ѵ -1-ǱϢ
+////////////////////////////////////////////////////////////
+int dbus_process_message(DBUS_CONTEXT* context, DBusMessage* message)
+{
+	DBUS_APPLICATION self = context->self;
+	DBUS_TRACE trace;
+	DBUS_ARGS args;
+
+	// 1.ȶϢĿַ
+	const char* path = dbus_message_get_path(message);
+	if (!path || strcmp(path, self.object_path)) {
+		return -1;
+	}
+
+	// 2.ȡټ¼ϢδЯʱ٣
+	dbus_trace_extract(message, &trace);
+	dbus_trace_mark(&trace, "dispatch");
+
+	// 3.Ϣݴã
+	do {
+		if (dbus_message_is_signal(message, self.interface_name, DBUS_MEMBER_SIGNAL)) {
+
+			if (dbus_decode_message(&context->arena, message, &args)) {
+				break;
 			}
-			else if (dbus_message_is_method_call(message, self.interface_name, DBUS_MEMBER_METHOD)) {
-				dbus_reply_method_call(connection, message);
+			if (!args.count) {
+				printf("Error: Message Has No Argument\n");
+				break;
 			}
-			else {
-				printf("Error: Unkown Message Type\n");
+			dbus_handle_signal(context, args.data[0]);
+
+			dbus_trace_mark(&trace, "handler");
+			dbus_trace_write(&trace, DBUS_MEMBER_SIGNAL);
+		}
+		else if (dbus_message_is_signal(message, self.interface_name, DBUS_MEMBER_BATCH)) {
+			dbus_process_batch(context, message);
+		}
+		else if (dbus_message_is_method_call(message, self.interface_name, DBUS_MEMBER_METHOD)) {
+
+			// ʱش󣬱÷ȵʱ
+			if (dbus_decode_message(&context->arena, message, &args) || !args.count) {
+				dbus_limit_reject(context, message, DBUS_ERROR_INVALID_ARGS, "Expected STRING or INT32 arguments");
+				break;
 			}
-		} while (0);
-		
-		dbus_message_unref(message);
+			dbus_reply_method_call(context->connection, message, &args, &trace);
+		}
+		else if (dbus_message_is_method_call(message, self.interface_name, DBUS_MEMBER_SHM)) {
+			dbus_shm_accept(context, message);
+		}
+		else if (!dbus_stream_handle(context, message)) {
+			// ϢѴ
+		}
+		else {
+			printf("Error: Unkown Message Type\n");
+			dbus_limit_reject(context, message, DBUS_ERROR_UNKNOWN_METHOD, "Unknown method");
+		}
+	} while (0);
+
+	dbus_arena_reset(&context->arena);
+	return 0;
+}
+
+static char stream_dir[PATH_MAX];
+static double limit_rate;
+static double limit_burst;
+static DBUS_LIMIT_STATS limit_stats;
+
+
+////////////////////////////////////////////////////////////
+// ܣýĿ¼δʱܾȫϵκηͷ
+//       ڸĿ¼дļӦʹרĿ¼
+// 룺Ŀ¼NULL-
+// 
+// أ0-ɹ -1-Ŀ¼
+////////////////////////////////////////////////////////////
+int dbus_set_stream_dir(const char* dir)
+{
+	struct stat st;
+
+	if (!dir) {
+		stream_dir[0] = '\0';
+		return 0;
+	}
+	if (stat(dir, &st) || !S_ISDIR(st.st_mode)) {
+		printf("Error: %s Is Not a Directory\n", dir);
+		return -1;
+	}
+	if (strlen(dir) + 1 + NAME_MAX >= sizeof(stream_dir)) {
+		printf("Error: Stream Directory Path Too Long\n");
+		return -1;
 	}
+	strcpy(stream_dir, dir);
+	return 0;
+}
 
+////////////////////////////////////////////////////////////
+// ܣýշÿͷĵޣȫԱһͰ
+// 룺ÿʣ0-ͻ
+// 
+// أ0-ɹ -1-
+////////////////////////////////////////////////////////////
+int dbus_set_rate_limit(double rate, double burst)
+{
+	if (rate < 0 || (rate > 0 && burst < 1)) {
+		printf("Error: Invalid Rate Limit\n");
+		return -1;
+	}
+	limit_rate = rate;
+	limit_burst = burst;
 	return 0;
 }
+
+////////////////////////////////////////////////////////////
+// ܣȡһdbus_receiveͳ
+// 룺
+// ͳݽṹ
+// أ
+////////////////////////////////////////////////////////////
+void dbus_get_limit_stats(DBUS_LIMIT_STATS* stats)
+{
+	*stats = limit_stats;
+}
+
+////////////////////////////////////////////////////////////
+// ܣɽ·δʱ.part׺
+// 룺ƣǷɣ
+// ·
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_receive_stream_path(const char* name, int done, char* path, size_t length)
+{
+	snprintf(path, length, "%s/%s%s", stream_dir, name, done ? "" : ".part");
+}
+
+////////////////////////////////////////////////////////////
+// ܣʱΪʽļʧʱɾ
+// 룺¼ļ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_receive_stream_event(DBUS_STREAM* stream, int event, void* user_data)
+{
+	int fd = (int)(intptr_t)user_data;
+	char part[PATH_MAX];
+	char path[PATH_MAX];
+
+	close(fd);
+	dbus_receive_stream_path(dbus_stream_get_name(stream), 0, part, sizeof(part));
+	dbus_receive_stream_path(dbus_stream_get_name(stream), 1, path, sizeof(path));
+
+	if (event == DBUS_STREAM_EVENT_DONE && !rename(part, path)) {
+		printf("[%d] Got Stream %s: %llu Bytes\n", getpid(), path, dbus_stream_get_size(stream));
+		return;
+	}
+	printf("[%d] Stream %s Failed At %llu Of %llu Bytes\n", getpid(), dbus_stream_get_name(stream),
+		dbus_stream_get_offset(stream), dbus_stream_get_size(stream));
+	unlink(part);
+}
+
+////////////////////////////////////////////////////////////
+// ܣԶ˴ʱõĿ¼´ļ
+// 룺λãû
+// λ
+// أ0- -1-ܾ
+////////////////////////////////////////////////////////////
+static int dbus_receive_stream(DBUS_STREAM* stream, DBUS_STREAM_SINK* sink, void* user_data)
+{
+	(void)user_data;
+
+	// 1.ֻļܰĿ¼
+	const char* name = dbus_stream_get_name(stream);
+	if (!*name || strchr(name, '/') || !strcmp(name, ".") || !strcmp(name, "..") || strlen(name) > NAME_MAX - strlen(".part")) {
+		printf("Error: Invalid Stream Name\n");
+		return -1;
+	}
+
+	// 2.ļӣ
+	char path[PATH_MAX];
+	dbus_receive_stream_path(name, 0, path, sizeof(path));
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		printf("Error: Open %s Failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	sink->fd = fd;
+	sink->function = dbus_receive_stream_event;
+	sink->user_data = (void*)(intptr_t)fd;
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣѭϢյSIGTERM/SIGINTʱ˳
+// 룺շݽṹ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_receive(DBUS_APPLICATION self)
+{
+	// 1.ӵߣעƲϢɸѡ
+	DBUS_CONTEXT* context = dbus_context_open(self, DBUS_CONTEXT_FLAG_RECEIVE);
+	if (!context) {
+		return -1;
+	}
+
+	// 2.յSIGTERM/SIGINTʱͷƣյϢ˳
+	if (dbus_context_shutdown_on_signal(context, SIGTERM) || dbus_context_shutdown_on_signal(context, SIGINT)) {
+		dbus_context_close(context);
+		return -1;
+	}
+
+	// 3.Ŀ¼ʱԶ˷浽Ŀ¼
+	if (stream_dir[0]) {
+		dbus_context_set_stream_function(context, dbus_receive_stream, NULL);
+	}
+
+	// 4.ʱÿͷ
+	if (limit_rate > 0 && dbus_context_set_rate_limit(context, NULL, limit_rate, limit_burst)) {
+		dbus_context_close(context);
+		return -1;
+	}
+
+	// 5.Ϣѭ˳ʱͳ
+	int ret = dbus_context_run(context);
+	dbus_context_get_limit_stats(context, &limit_stats);
+
+	dbus_context_close(context);
+	return ret;
+}
@@ -2,10 +2,53 @@
 #define DBUS_H_
 
 
+#include <stddef.h>
+
 #define DBUS_MEMBER_SIGNAL		"signal"
 #define DBUS_MEMBER_METHOD		"method"
+#define DBUS_MEMBER_SHM			"shm"		// ڴͨ
+#define DBUS_MEMBER_BATCH		"batch"		// ϲ¼źŷ
+#define DBUS_MEMBER_STREAM_OPEN		"stream_open"	// šơܳ
+#define DBUS_MEMBER_STREAM_CHUNK	"stream_chunk"	// Ƭšš
+#define DBUS_MEMBER_STREAM_CLOSE	"stream_close"	// رšܳȡǷ
 #define DBUS_SIGNAL_RULE		"type='signal',interface='%s'"
 
+#define DBUS_RECONNECT_DELAY		100		// ʼ룩ÿʧܷ
+#define DBUS_RECONNECT_DELAY_MAX	5000	// 룩
+#define DBUS_CONNECT_ATTEMPTS		5		// ʽߵĳԴ
+#define DBUS_OUTGOING_MAX			256		// ڼ仺ĴϢ
+#define DBUS_SENDER_QUEUE_MAX		64		// ÿͷĴϢ
+#define DBUS_SENDER_MAX				1024	// ¼ķͷޣʱ̭зͷ
+#define DBUS_DISPATCH_BUDGET		64		// ÿηַദϢ
+#define DBUS_DRAIN_TIMEOUT			5000	// ˳ʱȴϢʱ䣨룩
+
+#define DBUS_BATCH_SIGNATURE		"a(sv)"	// ŷÿ¼ĳԱ
+#define DBUS_BATCH_WINDOW			5		// һ¼ȴʱ䣨룩
+#define DBUS_BATCH_EVENTS			256		// ÿŷ¼
+#define DBUS_BATCH_BYTES			(64 * 1024)	// ÿŷֽ㣩
+
+#define DBUS_SHM_SIZE				(1024 * 1024)	// ڴͨС
+#define DBUS_SHM_MAX				16		// շͬʱֵĹڴͨ
+#define DBUS_SEND_RETRY				(-2)	// ͷֵڴͨԺԣʧΪ-1
+
+#define DBUS_COMPRESS_LZ4			1		// ѹ뷽ʽ
+#define DBUS_COMPRESS_SIGNATURE		"(yuay)"	// ѹַ뷽ʽԭʼȡѹ
+#define DBUS_COMPRESS_MAX			(64 * 1024 * 1024)	// ѹ/ѹԭʼ
+
+#define DBUS_ARENA_SIZE				(4 * 1024)		// շʼС
+#define DBUS_ARENA_MAX				(1024 * 1024)	// շݵ
+
+#define DBUS_TRACE_SIGNATURE		"(ta(sut))"	// ٲĩβٺš׶Σơ̺šʱ
+#define DBUS_TRACE_STAGE_MAX		32		// ÿϢ¼Ľ׶θ
+#define DBUS_TRACE_NAME_MAX			24		// ׶󳤶ȣ
+
+#define DBUS_STREAM_CHUNK			(128 * 1024)	// ƬСƬ֮ԲϢ
+#define DBUS_STREAM_WINDOW			4		// ÿͬʱȴȷϵķƬ
+#define DBUS_STREAM_MAX				16		// շͬʱյ
+#define DBUS_STREAM_IDLE_TIMEOUT	30000	// ʱ䣨룩ûյϢʱ
+
+#define DBUS_AGENT_NAME				"dbus-agent.sock"	// פʹĬϿ׽֣λ$XDG_RUNTIME_DIR
+
 
 ////////////////////////////////////////////////////////////
 //
@@ -39,10 +82,169 @@ typedef struct _DBUS_DATA
  
 }DBUS_DATA;
 
+////////////////////////////////////////////////////////////
+// ϢͼֵڴǰЧҪʱиƣ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_ARGS
+{
+	int count;
+	DBUS_DATA* data;
+
+}DBUS_ARGS;
+
+////////////////////////////////////////////////////////////
+// D-Busģӿڣṹ嶨dbus_private.h
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_CONTEXT DBUS_CONTEXT;
+
+#define DBUS_CONTEXT_FLAG_RECEIVE	0x1		// Ϣɸѡյź뺯
+
+#define DBUS_SEND_FLAG_SHM			0x1		// ǰշڴͨ
+#define DBUS_SEND_FLAG_BATCH		0x2		// ĬϺϲ԰źźϲΪŷⷢ
+
+////////////////////////////////////////////////////////////
+// Ƭӿڣṹ嶨dbus_private.h
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_STREAM DBUS_STREAM;
+
+#define DBUS_STREAM_EVENT_WRITABLE	1		// пλԼд
+#define DBUS_STREAM_EVENT_DONE		2		// ȫȷϣ֮ͷţ
+#define DBUS_STREAM_EVENT_FAILED	3		// ʧܣ֮ͷţ
+
+typedef void (*DBUS_STREAM_FUNCTION)(DBUS_STREAM* stream, int event, void* user_data);
+
+////////////////////////////////////////////////////////////
+// λãbufferǿʱд뻺ƫдfdɵ÷رգ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_STREAM_SINK
+{
+	char* buffer;					// ÷
+	size_t capacity;				// ССܳ
+	int fd;							// ļ
+	DBUS_STREAM_FUNCTION function;	// ɻʧʱص
+	void* user_data;
+
+}DBUS_STREAM_SINK;
+
+typedef int (*DBUS_STREAM_ACCEPT_FUNCTION)(DBUS_STREAM* stream, DBUS_STREAM_SINK* sink, void* user_data);
+
+#define DBUS_EVENT_READABLE			0x1
+#define DBUS_EVENT_WRITABLE			0x2
+#define DBUS_EVENT_ERROR			0x4
+#define DBUS_EVENT_HANGUP			0x8
+
+////////////////////////////////////////////////////////////
+// ݽṹ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_RECONNECT_POLICY
+{
+	int delay;				// ʼ룩
+	int delay_max;			// 룩
+	int attempts;			// ʧܴޣ0-
+	int outgoing_max;		// ڼ仺ĴϢޣ0-
+
+}DBUS_RECONNECT_POLICY;
+
+////////////////////////////////////////////////////////////
+// źźϲԣevents1ʾϲ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_BATCH_POLICY
+{
+	int window;				// һ¼ȴʱ䣨룩0-¼ѭʱ
+	int events;				// ÿŷ¼
+	int bytes;				// ÿŷֽ㣩
+
+}DBUS_BATCH_POLICY;
+
+////////////////////////////////////////////////////////////
+// ͳݽṹ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_LIMIT_STATS
+{
+	unsigned long long accepted;		// ѽ
+	unsigned long long throttled;		// ʱܾ
+	unsigned long long overflowed;		// ܾ
+
+}DBUS_LIMIT_STATS;
+
+////////////////////////////////////////////////////////////
+// ѹͳݽṹ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_COMPRESS_STATS
+{
+	unsigned long long compressed;			// ѹ͵Ĳ
+	unsigned long long decompressed;		// ѹյĲ
+	unsigned long long raw_bytes;			// ѹǰֽ
+	unsigned long long compressed_bytes;	// ѹֽ
+	double ratio;							// ѹ/ѹǰ
+
+}DBUS_COMPRESS_STATS;
+
+////////////////////////////////////////////////////////////
+// صҪ¼仯ʱãeventsΪ0ʾƳ
+// ʱصһγʱʱ䷢仯ʱãintervalΪ-1ʾ޶ʱ
+// صԶ̺÷ػʧʱãstatusΪ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+typedef void (*DBUS_WATCH_FUNCTION)(int fd, unsigned int events, void* user_data);
+typedef void (*DBUS_TIMEOUT_FUNCTION)(int interval, void* user_data);
+typedef void (*DBUS_REPLY_FUNCTION)(int status, DBUS_DATA data, void* user_data);
+
 
 int dbus_send_signal(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DBUS_DATA data);
 int dbus_send_method_call(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DBUS_DATA data);
+int dbus_send_stream(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, const char* path);
+int dbus_send_signals(DBUS_APPLICATION sender, DBUS_APPLICATION receiver, DBUS_DATA data, int count, int flags);
 int dbus_receive(DBUS_APPLICATION self);
+int dbus_set_stream_dir(const char* dir);
+int dbus_set_rate_limit(double rate, double burst);
+void dbus_get_limit_stats(DBUS_LIMIT_STATS* stats);
+
+int dbus_set_compression(int threshold);
+void dbus_get_compression_stats(DBUS_COMPRESS_STATS* stats);
+
+int dbus_trace_open(const char* path);
+void dbus_trace_close(void);
+
+int dbus_agent_run(DBUS_APPLICATION self, const char* path);
+int dbus_agent_send_signal(const char* path, DBUS_APPLICATION receiver, DBUS_DATA data);
+int dbus_agent_send_method_call(const char* path, DBUS_APPLICATION receiver, DBUS_DATA data);
+
+int dbus_fuzz_run(DBUS_APPLICATION receiver, int seconds, unsigned int seed, int target);
+
+DBUS_CONTEXT* dbus_context_open(DBUS_APPLICATION self, int flags);
+void dbus_context_close(DBUS_CONTEXT* context);
+void dbus_context_set_watch_function(DBUS_CONTEXT* context, DBUS_WATCH_FUNCTION function, void* user_data);
+void dbus_context_set_timeout_function(DBUS_CONTEXT* context, DBUS_TIMEOUT_FUNCTION function, void* user_data);
+int dbus_context_get_timeout(DBUS_CONTEXT* context);
+int dbus_context_handle_watch(DBUS_CONTEXT* context, int fd, unsigned int events);
+int dbus_context_handle_timeout(DBUS_CONTEXT* context);
+int dbus_context_dispatch_ready(DBUS_CONTEXT* context);
+int dbus_context_send_signal(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data);
+int dbus_context_send_method_call(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data, DBUS_REPLY_FUNCTION function, void* user_data);
+int dbus_context_add_match(DBUS_CONTEXT* context, const char* rule);
+void dbus_context_set_reconnect_policy(DBUS_CONTEXT* context, DBUS_RECONNECT_POLICY policy);
+int dbus_context_is_connected(DBUS_CONTEXT* context);
+int dbus_context_set_rate_limit(DBUS_CONTEXT* context, const char* member, double rate, double burst);
+void dbus_context_get_limit_stats(DBUS_CONTEXT* context, DBUS_LIMIT_STATS* stats);
+int dbus_context_get_sender_stats(DBUS_CONTEXT* context, const char* sender, DBUS_LIMIT_STATS* stats);
+int dbus_context_open_shm(DBUS_CONTEXT* context, DBUS_APPLICATION receiver);
+void dbus_context_set_batch_policy(DBUS_CONTEXT* context, DBUS_BATCH_POLICY policy);
+int dbus_context_flush_batch(DBUS_CONTEXT* context);
+void dbus_context_shutdown(DBUS_CONTEXT* context);
+int dbus_context_shutdown_on_signal(DBUS_CONTEXT* context, int signum);
+void dbus_context_set_drain_timeout(DBUS_CONTEXT* context, int timeout);
+int dbus_context_is_drained(DBUS_CONTEXT* context);
+void dbus_context_set_stream_function(DBUS_CONTEXT* context, DBUS_STREAM_ACCEPT_FUNCTION function, void* user_data);
+void dbus_context_set_stream_timeout(DBUS_CONTEXT* context, int timeout);
+DBUS_STREAM* dbus_stream_open(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, const char* name, unsigned long long size,
+	DBUS_STREAM_FUNCTION function, void* user_data);
+long dbus_stream_write(DBUS_STREAM* stream, const void* data, size_t length);
+int dbus_stream_close(DBUS_STREAM* stream);
+const char* dbus_stream_get_name(DBUS_STREAM* stream);
+unsigned long long dbus_stream_get_size(DBUS_STREAM* stream);
+unsigned long long dbus_stream_get_offset(DBUS_STREAM* stream);
+int dbus_context_run(DBUS_CONTEXT* context);
+void dbus_context_quit(DBUS_CONTEXT* context);
 
 
 ////////////////////////////////////////////////////////////
@@ -429,6 +631,126 @@ int dbus_receive(DBUS_APPLICATION self);
  *		Decrements the reference count on a pending call, freeing it if the count reaches 0.
 */
 ////////////////////////////////////////////////////////////
+/**
+ * [Function]
+ *		dbus_bool_t dbus_pending_call_set_notify(DBusPendingCall* pending, DBusPendingCallNotifyFunction function, void* user_data, DBusFreeFunction free_user_data)
+ * [Parameters]
+ *		(1) pending:	the pending call
+ *		(2) function:	notifier function
+ *		(3) user_data:	data to pass to notifier function
+ *		(4) free_user_data:
+ *						function to free the user data
+ * [Description]
+ *		Sets a notification function to be called when the reply is received or the pending call times out.
+ * [Returns]
+ *		FALSE if not enough memory.
+*/
+////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////
+/**
+ * [Function]
+ *		dbus_bool_t dbus_connection_set_watch_functions(DBusConnection* connection, DBusAddWatchFunction add_function, DBusRemoveWatchFunction remove_function,
+ *			DBusWatchToggledFunction toggled_function, void* data, DBusFreeFunction free_data_function)
+ * [Parameters]
+ *		(1) connection:	the connection
+ *		(2) add_function:	function to begin monitoring a new descriptor
+ *		(3) remove_function:function to stop monitoring a descriptor
+ *		(4) toggled_function:function to notify of enable/disable
+ *		(5) data:		data to pass to add_function and remove_function
+ *		(6) free_data_function:function to be called to free the data
+ * [Description]
+ *		(1) Sets the watch functions for the connection.
+ *		(2) These functions are responsible for making the application's main loop aware of file descriptors that need to be monitored for events, using select() or poll().
+ *		(3) When using Qt, typically the DBusAddWatchFunction would create a QSocketNotifier. When using GLib, the DBusAddWatchFunction could call g_io_add_watch(), or could be used as part of a more elaborate GSource.
+ *		(4) Note that when a watch is added, it may not be enabled.
+ *		(5) The DBusWatchToggledFunction notifies the application that the watch has been enabled or disabled. Call dbus_watch_get_enabled() to check this.
+ * [Returns]
+ *		FALSE on failure (no memory).
+*/
+////////////////////////////////////////////////////////////
+/**
+ * [Function]
+ *		dbus_bool_t dbus_connection_set_timeout_functions(DBusConnection* connection, DBusAddTimeoutFunction add_function, DBusRemoveTimeoutFunction remove_function,
+ *			DBusTimeoutToggledFunction toggled_function, void* data, DBusFreeFunction free_data_function)
+ * [Parameters]
+ *		(1) connection:	the connection
+ *		(2) add_function:	function to add a timeout
+ *		(3) remove_function:function to remove a timeout
+ *		(4) toggled_function:function to notify of enable/disable
+ *		(5) data:		data to pass to add_function and remove_function
+ *		(6) free_data_function:function to be called to free the data
+ * [Description]
+ *		(1) Sets the timeout functions for the connection.
+ *		(2) These functions are responsible for making the application's main loop aware of timeouts.
+ *		(3) The DBusTimeout can be queried for the timer interval using dbus_timeout_get_interval(), and
+ *			dbus_timeout_handle() should be called repeatedly, each time the interval elapses, starting after it has elapsed once.
+ * [Returns]
+ *		FALSE on failure (no memory).
+*/
+////////////////////////////////////////////////////////////
+/**
+ * [Function]
+ *		dbus_bool_t dbus_watch_handle(DBusWatch* watch, unsigned int flags)
+ * [Parameters]
+ *		(1) watch:		the DBusWatch object.
+ *		(2) flags:		the poll condition using DBusWatchFlags values
+ * [Description]
+ *		(1) Called to notify the D-Bus library when a previously-added watch is ready for reading or writing, or has an exception such as a hangup.
+ *		(2) If this function returns FALSE, then the file descriptor may still be ready for reading or writing, but more memory is needed in order to do the reading or writing.
+ *			If you ignore the FALSE return, your application may spin in a busy loop on the file descriptor until memory becomes available.
+ * [Returns]
+ *		FALSE if there wasn't enough memory.
+*/
+////////////////////////////////////////////////////////////
+/**
+ * [Function]
+ *		DBusDispatchStatus dbus_connection_dispatch(DBusConnection* connection)
+ * [Parameters]
+ *		(1) connection:	the connection
+ * [Description]
+ *		(1) Processes any incoming data.
+ *		(2) If there's incoming raw data that has not yet been parsed, it is parsed, which may or may not result in adding messages to the incoming queue.
+ *		(3) The incoming data buffer is filled when the connection reads from its underlying transport (such as a socket).
+ *			Reading usually happens in dbus_watch_handle() or dbus_connection_read_write().
+ *		(4) If there are complete messages in the incoming queue, dbus_connection_dispatch() removes one message from the queue and processes it.
+ *			Processing has three steps: pending call replies, filters, object path handlers.
+ * [Returns]
+ *		Dispatch status, DBUS_DISPATCH_DATA_REMAINS if more messages may be dispatched.
+*/
+////////////////////////////////////////////////////////////
+/**
+ * [Function]
+ *		dbus_bool_t dbus_connection_add_filter(DBusConnection* connection, DBusHandleMessageFunction function, void* user_data, DBusFreeFunction free_data_function)
+ * [Parameters]
+ *		(1) connection:	the connection
+ *		(2) function:	function to handle messages
+ *		(3) user_data:	user data to pass to the function
+ *		(4) free_data_function:function to use for freeing user data
+ * [Description]
+ *		(1) Adds a message filter.
+ *		(2) Filters are handlers that are run on all incoming messages, prior to the objects registered with dbus_connection_register_object_path().
+ *		(3) Filters are run in the order that they were added.
+ * [Returns]
+ *		TRUE on success, FALSE if not enough memory.
+*/
+////////////////////////////////////////////////////////////
+/**
+ * [Function]
+ *		dbus_bool_t dbus_message_set_data(DBusMessage* message, dbus_int32_t slot, void* data, DBusFreeFunction free_data_func)
+ * [Parameters]
+ *		(1) message:	the message
+ *		(2) slot:		the slot number, allocated with dbus_message_allocate_data_slot()
+ *		(3) data:		the data to store
+ *		(4) free_data_func:finalizer function for the data
+ * [Description]
+ *		(1) Stores a pointer on a DBusMessage, along with an optional function to be used for freeing the data when the data is set again, or when the message is finalized.
+ *		(2) The slot number must have been allocated with dbus_message_allocate_data_slot().
+ * [Returns]
+ *		TRUE if there was enough memory to store the data.
+*/
+////////////////////////////////////////////////////////////
 
 
 #endif // !DBUS_H_
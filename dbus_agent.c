@@ -0,0 +1,674 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "dbus.h"
+
+
+#define DBUS_AGENT_MAGIC		0x44424147		// "DBAG"
+#define DBUS_AGENT_KIND_SIGNAL	0
+#define DBUS_AGENT_KIND_METHOD	1
+#define DBUS_AGENT_FIELDS		5
+#define DBUS_AGENT_IO_TIMEOUT	1000			// ׽ֵζдȴ룩
+
+
+////////////////////////////////////////////////////////////
+// ͷΪշơ·ӿڡԱݣ0ʾNULL
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_AGENT_REQUEST
+{
+	unsigned int magic;
+	unsigned int kind;
+	unsigned int type;
+	unsigned int lengths[DBUS_AGENT_FIELDS];
+
+}DBUS_AGENT_REQUEST;
+
+////////////////////////////////////////////////////////////
+// ƷͷΪݣ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_AGENT_RESPONSE
+{
+	int status;
+	unsigned int type;
+	unsigned int length;
+
+}DBUS_AGENT_RESPONSE;
+
+////////////////////////////////////////////////////////////
+// Ŀͻӣÿһ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_AGENT_CLIENT
+{
+	int fd;
+	unsigned int id;
+	char* buffer;
+	size_t used;
+	int busy;
+
+}DBUS_AGENT_CLIENT;
+
+////////////////////////////////////////////////////////////
+// ״̬ͬһֻһ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_AGENT
+{
+	DBUS_CONTEXT* context;
+	int listen_fd;
+	DBUS_AGENT_CLIENT* clients;
+	int client_count;
+	unsigned int next_id;
+	struct pollfd* watches;		// Ҫӡ˳ѣ
+	int watch_count;
+	int watch_capacity;
+
+}DBUS_AGENT;
+
+
+static DBUS_AGENT agent;
+
+
+////////////////////////////////////////////////////////////
+// ܣдȫݣʱȴ
+// 룺ݣ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_agent_write(int fd, const void* data, size_t length)
+{
+	const char* p = data;
+
+	while (length) {
+		ssize_t ret = send(fd, p, length, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			struct pollfd pfd = { fd, POLLOUT, 0 };
+			if (errno == EAGAIN && poll(&pfd, 1, DBUS_AGENT_IO_TIMEOUT) > 0) {
+				continue;
+			}
+			return -1;
+		}
+		p += ret;
+		length -= ret;
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡָȵ
+// 룺
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_agent_read(int fd, void* data, size_t length)
+{
+	char* p = data;
+
+	while (length) {
+		ssize_t ret = read(fd, p, length);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		}
+		if (ret <= 0) {
+			return -1;
+		}
+		p += ret;
+		length -= ret;
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׽ֵַĬϷֻбûɷʵ$XDG_RUNTIME_DIR£
+// 룺׽·NULL-$XDG_RUNTIME_DIR/DBUS_AGENT_NAME
+// ַ
+// أ0-ɹ -1-·δXDG_RUNTIME_DIR
+////////////////////////////////////////////////////////////
+static int dbus_agent_address(const char* path, struct sockaddr_un* address)
+{
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+
+	int length;
+	if (path) {
+		length = snprintf(address->sun_path, sizeof(address->sun_path), "%s", path);
+	}
+	else {
+		const char* dir = getenv("XDG_RUNTIME_DIR");
+		if (!dir || !dir[0]) {
+			printf("Error: XDG_RUNTIME_DIR Not Set, Specify the Agent Socket With -a\n");
+			return -1;
+		}
+		length = snprintf(address->sun_path, sizeof(address->sun_path), "%s/%s", dir, DBUS_AGENT_NAME);
+	}
+	if (length < 0 || length >= (int)sizeof(address->sun_path)) {
+		printf("Error: Agent Socket Path Too Long\n");
+		return -1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣɾĿ׽֣·͵ļʱɾ
+// 룺׽·
+// 
+// أ0-ɾ򲻴 -1-׽ֻɾʧ
+////////////////////////////////////////////////////////////
+static int dbus_agent_unlink(const char* path)
+{
+	struct stat st;
+
+	if (lstat(path, &st)) {
+		if (errno == ENOENT) {
+			return 0;
+		}
+		printf("Error: Stat %s Failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (!S_ISSOCK(st.st_mode)) {
+		printf("Error: %s Exists and Is Not a Socket\n", path);
+		return -1;
+	}
+	if (unlink(path) && errno != ENOENT) {
+		printf("Error: Remove %s Failed: %s\n", path, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ¼ѭص¼Ҫ
+// 룺¼0ʾƳû
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_agent_watch(int fd, unsigned int events, void* user_data)
+{
+	(void)user_data;
+
+	int i;
+	for (i = 0; i < agent.watch_count; i++) {
+		if (agent.watches[i].fd == fd) {
+			break;
+		}
+	}
+
+	if (!events) {
+		if (i < agent.watch_count) {
+			agent.watches[i] = agent.watches[--agent.watch_count];
+		}
+		return;
+	}
+	if (i == agent.watch_count) {
+		if (agent.watch_count >= agent.watch_capacity) {
+			int capacity = agent.watch_capacity ? agent.watch_capacity * 2 : 4;
+			struct pollfd* watches = realloc(agent.watches, capacity * sizeof(struct pollfd));
+			if (!watches) {
+				printf("Error: Out of Memory\n");
+				return;
+			}
+			agent.watches = watches;
+			agent.watch_capacity = capacity;
+		}
+		agent.watch_count++;
+	}
+
+	agent.watches[i].fd = fd;
+	agent.watches[i].events = ((events & DBUS_EVENT_READABLE) ? POLLIN : 0) | ((events & DBUS_EVENT_WRITABLE) ? POLLOUT : 0);
+	agent.watches[i].revents = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣرտͻ
+// 룺ͻ±
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_agent_close_client(int index)
+{
+	close(agent.clients[index].fd);
+	free(agent.clients[index].buffer);
+	agent.clients[index] = agent.clients[--agent.client_count];
+}
+
+////////////////////////////////////////////////////////////
+// ܣͻдر
+// 룺ͻ±꣬״̬ݣźΪNULL
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_agent_respond(int index, int status, const DBUS_DATA* data)
+{
+	DBUS_AGENT_RESPONSE response;
+	response.status = status;
+	response.type = data ? data->type : DBUS_DATA_TYPE_STRING;
+	response.length = data && data->value ? strlen(data->value) + 1 : 0;
+
+	if (dbus_agent_write(agent.clients[index].fd, &response, sizeof(response))
+		|| (response.length && dbus_agent_write(agent.clients[index].fd, data->value, response.length))) {
+		printf("Error: Agent Client Gone\n");
+	}
+	dbus_agent_close_client(index);
+}
+
+////////////////////////////////////////////////////////////
+// ܣԶ̺÷صתĿͻˣͻ˿ѶϿ
+// 룺״̬ݣͻ˱
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_agent_reply(int status, DBUS_DATA data, void* user_data)
+{
+	unsigned int id = (unsigned int)(uintptr_t)user_data;
+
+	int i;
+	for (i = 0; i < agent.client_count; i++) {
+		if (agent.clients[i].id == id) {
+			dbus_agent_respond(i, status, status ? NULL : &data);
+			return;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡͻͨķ
+// 룺ͻ±
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_agent_handle_client(int index)
+{
+	DBUS_AGENT_CLIENT* client = &agent.clients[index];
+	DBUS_AGENT_REQUEST* request = (DBUS_AGENT_REQUEST*)client->buffer;
+	size_t need = sizeof(DBUS_AGENT_REQUEST);
+	int i;
+
+	// 1.ȡͷõܳȺ󻺳
+	if (client->used >= sizeof(DBUS_AGENT_REQUEST)) {
+		for (i = 0; i < DBUS_AGENT_FIELDS; i++) {
+			need += request->lengths[i];
+		}
+	}
+	ssize_t ret = read(client->fd, client->buffer + client->used, need - client->used);
+	if (ret <= 0) {
+		if (ret < 0 && (errno == EAGAIN || errno == EINTR)) {
+			return;
+		}
+		dbus_agent_close_client(index);
+		return;
+	}
+	client->used += ret;
+	if (client->used < need) {
+		return;
+	}
+
+	if (need == sizeof(DBUS_AGENT_REQUEST)) {
+		if (request->magic != DBUS_AGENT_MAGIC || request->kind > DBUS_AGENT_KIND_METHOD) {
+			printf("Error: Invalid Agent Request\n");
+			dbus_agent_close_client(index);
+			return;
+		}
+		for (i = 0; i < DBUS_AGENT_FIELDS; i++) {
+			if (request->lengths[i] > DBUS_COMPRESS_MAX) {
+				printf("Error: Invalid Agent Request\n");
+				dbus_agent_close_client(index);
+				return;
+			}
+			need += request->lengths[i];
+		}
+		char* buffer = realloc(client->buffer, need);
+		if (!buffer) {
+			printf("Error: Out of Memory\n");
+			dbus_agent_close_client(index);
+			return;
+		}
+		client->buffer = buffer;
+		request = (DBUS_AGENT_REQUEST*)buffer;
+		if (client->used < need) {
+			return;
+		}
+	}
+
+	// 2.ֶΣԽβ
+	char* fields[DBUS_AGENT_FIELDS];
+	char* p = client->buffer + sizeof(DBUS_AGENT_REQUEST);
+	for (i = 0; i < DBUS_AGENT_FIELDS; i++) {
+		fields[i] = NULL;
+		if (request->lengths[i]) {
+			if (p[request->lengths[i] - 1] != '\0') {
+				printf("Error: Invalid Agent Request\n");
+				dbus_agent_close_client(index);
+				return;
+			}
+			fields[i] = p;
+		}
+		p += request->lengths[i];
+	}
+
+	DBUS_APPLICATION receiver;
+	receiver.bus_name = fields[0];
+	receiver.object_path = fields[1];
+	receiver.interface_name = fields[2];
+	receiver.member_name = fields[3];
+
+	DBUS_DATA data;
+	data.type = request->type;
+	data.value = fields[4];
+
+	if (!receiver.object_path || !receiver.interface_name || !receiver.member_name || !data.value
+		|| (request->kind == DBUS_AGENT_KIND_METHOD && !receiver.bus_name)) {
+		printf("Error: Invalid Agent Request\n");
+		dbus_agent_close_client(index);
+		return;
+	}
+
+	// 3.ͨפӷͣźӺ󼴷õȴԶ̷
+	client->busy = 1;
+	if (request->kind == DBUS_AGENT_KIND_SIGNAL) {
+		dbus_agent_respond(index, dbus_context_send_signal(agent.context, receiver, data), NULL);
+	}
+	else if (dbus_context_send_method_call(agent.context, receiver, data, dbus_agent_reply, (void*)(uintptr_t)client->id)) {
+		dbus_agent_respond(index, -1, NULL);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣµĿͻ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_agent_accept(void)
+{
+	int fd = accept(agent.listen_fd, NULL, NULL);
+	if (fd < 0) {
+		return;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	DBUS_AGENT_CLIENT* clients = realloc(agent.clients, (agent.client_count + 1) * sizeof(DBUS_AGENT_CLIENT));
+	char* buffer = malloc(sizeof(DBUS_AGENT_REQUEST));
+	if (!clients || !buffer) {
+		printf("Error: Out of Memory\n");
+		if (clients) {
+			agent.clients = clients;
+		}
+		free(buffer);
+		close(fd);
+		return;
+	}
+	agent.clients = clients;
+
+	DBUS_AGENT_CLIENT* client = &agent.clients[agent.client_count++];
+	client->fd = fd;
+	client->id = ++agent.next_id;
+	client->buffer = buffer;
+	client->used = 0;
+	client->busy = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣгפʹһӣͨ׽ֽշ
+// 룺ͷݽṹbus_nameΪNULLʱעƣ׽·NULL-Ĭ·
+// 
+// أ0-˳ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_agent_run(DBUS_APPLICATION self, const char* path)
+{
+	struct sockaddr_un address;
+	struct pollfd* fds = NULL;
+	int capacity = 0;
+	int listening = 0;
+	int ret = -1;
+	int i;
+
+	memset(&agent, 0, sizeof(agent));
+	agent.listen_fd = -1;
+	if (dbus_agent_address(path, &address)) {
+		return -1;
+	}
+	path = address.sun_path;
+
+	// 1.ӵߣյSIGTERM/SIGINTʱѽյ˳
+	agent.context = dbus_context_open(self, 0);
+	if (!agent.context) {
+		return -1;
+	}
+	dbus_context_set_watch_function(agent.context, dbus_agent_watch, NULL);
+	if (dbus_context_shutdown_on_signal(agent.context, SIGTERM) || dbus_context_shutdown_on_signal(agent.context, SIGINT)) {
+		goto out;
+	}
+
+	// 2.׽ֻ֣ûʣ
+	agent.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (agent.listen_fd < 0) {
+		printf("Error: Create Agent Socket Failed: %s\n", strerror(errno));
+		goto out;
+	}
+	if (dbus_agent_unlink(path)) {
+		goto out;
+	}
+	mode_t mask = umask(077);
+	int bound = bind(agent.listen_fd, (struct sockaddr*)&address, sizeof(address));
+	umask(mask);
+	if (bound || listen(agent.listen_fd, SOMAXCONN)) {
+		printf("Error: Bind Agent Socket %s Failed: %s\n", path, strerror(errno));
+		goto out;
+	}
+	listening = 1;
+	printf("[%d] Agent Listening On %s\n", getpid(), path);
+
+	// 3.¼ѭ
+	while (!dbus_context_is_drained(agent.context)) {
+		// ϣĵǰΪ׽ͻˣͻ˸ޣ
+		int watches = agent.watch_count;
+		int count = watches + 1 + agent.client_count;
+		if (count > capacity) {
+			struct pollfd* grown = realloc(fds, count * sizeof(struct pollfd));
+			if (!grown) {
+				printf("Error: Out of Memory\n");
+				goto out;
+			}
+			fds = grown;
+			capacity = count;
+		}
+
+		for (i = 0; i < watches; i++) {
+			fds[i] = agent.watches[i];
+		}
+		fds[watches].fd = agent.listen_fd;
+		fds[watches].events = POLLIN;
+		for (i = 0; i < agent.client_count; i++) {
+			fds[watches + 1 + i].fd = agent.clients[i].fd;
+			fds[watches + 1 + i].events = agent.clients[i].busy ? 0 : POLLIN;
+		}
+		for (i = 0; i < count; i++) {
+			fds[i].revents = 0;
+		}
+
+		if (poll(fds, count, dbus_context_get_timeout(agent.context)) < 0 && errno != EINTR) {
+			printf("Poll Error: %s\n", strerror(errno));
+			goto out;
+		}
+
+		// 
+		for (i = 0; i < watches; i++) {
+			unsigned int events = 0;
+			if (fds[i].revents & POLLIN) {
+				events |= DBUS_EVENT_READABLE;
+			}
+			if (fds[i].revents & POLLOUT) {
+				events |= DBUS_EVENT_WRITABLE;
+			}
+			if (fds[i].revents & POLLERR) {
+				events |= DBUS_EVENT_ERROR;
+			}
+			if (fds[i].revents & POLLHUP) {
+				events |= DBUS_EVENT_HANGUP;
+			}
+			if (events && dbus_context_handle_watch(agent.context, fds[i].fd, events)) {
+				goto out;
+			}
+		}
+		dbus_context_handle_timeout(agent.context);
+
+		// ͻ󣨴пͻ˿ܱƳң
+		for (i = watches + 1; i < count; i++) {
+			if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+				continue;
+			}
+			int j;
+			for (j = 0; j < agent.client_count; j++) {
+				if (agent.clients[j].fd == fds[i].fd) {
+					dbus_agent_handle_client(j);
+					break;
+				}
+			}
+		}
+		if (fds[watches].revents & POLLIN) {
+			dbus_agent_accept();
+		}
+
+		dbus_context_dispatch_ready(agent.context);
+	}
+	ret = 0;
+
+out:
+	// 4.رգʱδɵͻ˷ʧܣٹر׽
+	while (agent.client_count) {
+		dbus_agent_respond(agent.client_count - 1, -1, NULL);
+	}
+	dbus_context_close(agent.context);
+	free(agent.clients);
+	free(agent.watches);
+	free(fds);
+	if (agent.listen_fd >= 0) {
+		close(agent.listen_fd);
+	}
+	if (listening) {
+		dbus_agent_unlink(path);
+	}
+	memset(&agent, 0, sizeof(agent));
+	return ret;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ󽻸ȴ
+// 룺׽·NULL-Ĭ·ͣշݽṹϢݽṹ
+// ͷݣ÷freeΪNULL
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_agent_request(const char* path, unsigned int kind, DBUS_APPLICATION receiver, DBUS_DATA data, DBUS_AGENT_RESPONSE* response, char** value)
+{
+	struct sockaddr_un address;
+	const char* fields[DBUS_AGENT_FIELDS] = { receiver.bus_name, receiver.object_path, receiver.interface_name, receiver.member_name, data.value };
+	DBUS_AGENT_REQUEST request;
+	int i;
+
+	*value = NULL;
+	if (dbus_agent_address(path, &address)) {
+		return -1;
+	}
+
+	// 1.Ӵ
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address))) {
+		printf("Connect Agent Error: %s: %s\n", address.sun_path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+
+	// 2.
+	request.magic = DBUS_AGENT_MAGIC;
+	request.kind = kind;
+	request.type = data.type;
+	for (i = 0; i < DBUS_AGENT_FIELDS; i++) {
+		request.lengths[i] = fields[i] ? strlen(fields[i]) + 1 : 0;
+	}
+	int failed = dbus_agent_write(fd, &request, sizeof(request));
+	for (i = 0; i < DBUS_AGENT_FIELDS && !failed; i++) {
+		failed = request.lengths[i] && dbus_agent_write(fd, fields[i], request.lengths[i]);
+	}
+
+	// 3.ȴ
+	if (!failed) {
+		failed = dbus_agent_read(fd, response, sizeof(*response));
+	}
+	if (!failed && response->length) {
+		*value = response->length <= DBUS_COMPRESS_MAX ? malloc(response->length) : NULL;
+		failed = !*value || dbus_agent_read(fd, *value, response->length) || (*value)[response->length - 1] != '\0';
+	}
+	close(fd);
+
+	if (failed) {
+		printf("Error: Agent Request Failed\n");
+		free(*value);
+		*value = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͨź
+// 룺׽·NULL-Ĭ·շݽṹϢݽṹ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_agent_send_signal(const char* path, DBUS_APPLICATION receiver, DBUS_DATA data)
+{
+	DBUS_AGENT_RESPONSE response;
+	char* value;
+
+	if (dbus_agent_request(path, DBUS_AGENT_KIND_SIGNAL, receiver, data, &response, &value)) {
+		return -1;
+	}
+	free(value);
+	if (response.status) {
+		printf("Error: Agent Send Failed\n");
+		return -1;
+	}
+
+	printf("Signal Sent\n");
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͨԶ̺
+// 룺׽·NULL-Ĭ·շݽṹϢݽṹ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_agent_send_method_call(const char* path, DBUS_APPLICATION receiver, DBUS_DATA data)
+{
+	DBUS_AGENT_RESPONSE response;
+	char* value;
+
+	if (dbus_agent_request(path, DBUS_AGENT_KIND_METHOD, receiver, data, &response, &value)) {
+		return -1;
+	}
+	if (response.status || !value) {
+		printf("Error: Agent Method Call Failed\n");
+		free(value);
+		return -1;
+	}
+
+	printf("[%d] Got Method Return %s: %s\n", getpid(), response.type == DBUS_DATA_TYPE_INT32 ? "INT32" : "STRING", value);
+	free(value);
+	return 0;
+}
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+#define DBUS_ARENA_ALIGN(size)		(((size) + 7) & ~(size_t)7)
+#define DBUS_ARENA_CHUNK_HEADER		DBUS_ARENA_ALIGN(sizeof(void*))
+
+
+////////////////////////////////////////////////////////////
+// ܣӷڴ棬ʱʱ飨ʱͷţ
+// 룺ֽ
+// 
+// أڴַNULL-ʧ
+////////////////////////////////////////////////////////////
+void* dbus_arena_alloc(DBUS_ARENA* arena, size_t size)
+{
+	size = DBUS_ARENA_ALIGN(size ? size : 1);
+
+	// 1.ǰʣռ㹻
+	if (arena->used + size <= arena->size) {
+		void* p = arena->base + arena->used;
+		arena->used += size;
+		return p;
+	}
+
+	// 2.״ʹ
+	if (!arena->base && size <= DBUS_ARENA_SIZE) {
+		arena->base = malloc(DBUS_ARENA_SIZE);
+		if (!arena->base) {
+			printf("Error: Out of Memory\n");
+			return NULL;
+		}
+		arena->size = DBUS_ARENA_SIZE;
+		arena->used = size;
+		return arena->base;
+	}
+
+	// 3.ѷڴʹãƶ鲢
+	char* chunk = malloc(DBUS_ARENA_CHUNK_HEADER + size);
+	if (!chunk) {
+		printf("Error: Out of Memory\n");
+		return NULL;
+	}
+	*(char**)chunk = arena->chunks;
+	arena->chunks = chunk;
+	arena->overflow += size;
+	return chunk + DBUS_ARENA_CHUNK_HEADER;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ÷ʱݣ֮ͬСϢٷڴ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_arena_reset(DBUS_ARENA* arena)
+{
+	if (arena->chunks) {
+		// 1.ͷŶ
+		while (arena->chunks) {
+			char* next = *(char**)arena->chunks;
+			free(arena->chunks);
+			arena->chunks = next;
+		}
+
+		// 2.ݣޣϢʹö飩
+		size_t size = arena->size;
+		while (size < arena->used + arena->overflow && size < DBUS_ARENA_MAX) {
+			size = size ? size * 2 : DBUS_ARENA_SIZE;
+		}
+		if (size > DBUS_ARENA_MAX) {
+			size = DBUS_ARENA_MAX;
+		}
+		if (size > arena->size) {
+			char* base = malloc(size);
+			if (base) {
+				free(arena->base);
+				arena->base = base;
+				arena->size = size;
+			}
+		}
+		arena->overflow = 0;
+	}
+
+	arena->used = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͷŷ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_arena_free(DBUS_ARENA* arena)
+{
+	dbus_arena_reset(arena);
+	free(arena->base);
+	arena->base = NULL;
+	arena->size = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢΪͼٲ
+//       ֱַָϢڲתıͽѹַڷ
+//       ϢꡢǰЧ
+// 룺D-BusϢ
+// ͼ
+// أ0-ɹ -1-ʧܣֵ֧Ĳ͡𻵵ѹݣ
+////////////////////////////////////////////////////////////
+int dbus_decode_message(DBUS_ARENA* arena, DBusMessage* message, DBUS_ARGS* args)
+{
+	DBusMessageIter iter;
+	char* value_str;
+	int value_int;
+	int count = 0;
+
+	args->count = 0;
+	args->data = NULL;
+
+	// 1.ͳƲ
+	if (!dbus_message_iter_init(message, &iter)) {
+		return 0;
+	}
+	do {
+		count++;
+	} while (dbus_message_iter_next(&iter));
+
+	args->data = dbus_arena_alloc(arena, count * sizeof(DBUS_DATA));
+	if (!args->data) {
+		return -1;
+	}
+
+	// 2.
+	dbus_message_iter_init(message, &iter);
+	do {
+		DBUS_DATA* data = &args->data[args->count];
+
+		switch (dbus_message_iter_get_arg_type(&iter)) {
+		case DBUS_TYPE_STRING:
+			dbus_message_iter_get_basic(&iter, &value_str);
+			data->type = DBUS_DATA_TYPE_STRING;
+			data->value = value_str;
+			args->count++;
+			break;
+		case DBUS_TYPE_INT32:
+			dbus_message_iter_get_basic(&iter, &value_int);
+			data->value = dbus_arena_alloc(arena, 12);
+			if (!data->value) {
+				return -1;
+			}
+			snprintf(data->value, 12, "%d", value_int);
+			data->type = DBUS_DATA_TYPE_INT32;
+			args->count++;
+			break;
+		case DBUS_TYPE_STRUCT:
+			if (dbus_trace_is_header(&iter)) {
+				break;
+			}
+			data->value = dbus_decompress_string(&iter, arena);
+			if (!data->value) {
+				return -1;
+			}
+			data->type = DBUS_DATA_TYPE_STRING;
+			args->count++;
+			break;
+		default:
+			printf("Error: Unknown Argument Type\n");
+			return -1;
+		}
+	} while (dbus_message_iter_next(&iter));
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+////////////////////////////////////////////////////////////
+// ܣźźϲԣȷǰŷ⣩
+// 룺D-Busģϲ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_set_batch_policy(DBUS_CONTEXT* context, DBUS_BATCH_POLICY policy)
+{
+	dbus_batch_flush(context);
+
+	if (policy.window < 0) {
+		policy.window = 0;
+	}
+	if (policy.bytes <= 0) {
+		policy.bytes = DBUS_BATCH_BYTES;
+	}
+	context->batch_policy = policy;
+}
+
+////////////////////////////////////////////////////////////
+// ܣǰŷ
+// 룺D-Bus
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_flush_batch(DBUS_CONTEXT* context)
+{
+	return dbus_batch_flush(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣŷĵΪѹرգ֮ٲϢ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_batch_reset_iter(DBUS_CONTEXT* context)
+{
+	DBusMessageIter closed = DBUS_MESSAGE_ITER_INIT_CLOSED;
+	context->batch_iter = closed;
+	context->batch_array = closed;
+}
+
+////////////////////////////////////////////////////////////
+// ܣǰŷ⣨¼δرʱȷͷϢ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_batch_drop(DBUS_CONTEXT* context)
+{
+	if (context->batch) {
+		dbus_message_iter_abandon_container_if_open(&context->batch_iter, &context->batch_array);
+		dbus_message_unref(context->batch);
+		context->batch = NULL;
+	}
+	dbus_batch_reset_iter(context);
+	free(context->batch_path);
+	free(context->batch_interface);
+	context->batch_path = NULL;
+	context->batch_interface = NULL;
+	context->batch_count = 0;
+	context->batch_bytes = 0;
+	context->batch_deadline = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׷¼ʧʱѴ򿪵¼ŷ⣨дһ¼޷أ
+// 룺D-Busģ¼ṹݵ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_batch_abandon(DBUS_CONTEXT* context, DBusMessageIter* struct_iter, DBusMessageIter* variant_iter)
+{
+	dbus_message_iter_abandon_container_if_open(struct_iter, variant_iter);
+	dbus_message_iter_abandon_container_if_open(&context->batch_array, struct_iter);
+	dbus_batch_drop(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣΪշŷ
+// 룺D-Busģշݽṹ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_batch_open(DBUS_CONTEXT* context, DBUS_APPLICATION receiver)
+{
+	// 1.ŷź
+	dbus_batch_reset_iter(context);
+	context->batch = dbus_message_new_signal(receiver.object_path, receiver.interface_name, DBUS_MEMBER_BATCH);
+	context->batch_path = strdup(receiver.object_path);
+	context->batch_interface = strdup(receiver.interface_name);
+	if (!context->batch || !context->batch_path || !context->batch_interface) {
+		printf("Error: Out of Memory\n");
+		dbus_batch_drop(context);
+		return -1;
+	}
+
+	// 2.¼飬֮¼ֱ׷ӵϢ
+	dbus_message_iter_init_append(context->batch, &context->batch_iter);
+	if (!dbus_message_iter_open_container(&context->batch_iter, DBUS_TYPE_ARRAY, "(sv)", &context->batch_array)) {
+		printf("Message Append Error: Out of Memory\n");
+		dbus_batch_drop(context);
+		return -1;
+	}
+
+	// 3.Ǽǵȴʱ
+	context->batch_deadline = dbus_monotonic_ms() + context->batch_policy.window;
+	dbus_context_update_timeout(context);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣһ¼׷ӵŷ⣨ѹ¼ֽﵽʱ
+// 룺D-BusģշݽṹϢݽṹ
+// 
+// أ0-Ѽ 1-δϲ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_batch_append(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data)
+{
+	if (context->batch_policy.events <= 1) {
+		return 1;
+	}
+
+	// 1.շͬʱȷǰŷ⣬¼˳
+	if (context->batch && (strcmp(context->batch_path, receiver.object_path) || strcmp(context->batch_interface, receiver.interface_name))) {
+		if (dbus_batch_flush(context)) {
+			return -1;
+		}
+	}
+	if (!context->batch && dbus_batch_open(context, receiver)) {
+		return -1;
+	}
+
+	// 2.׷(sv)Ա
+	DBusMessageIter struct_iter = DBUS_MESSAGE_ITER_INIT_CLOSED;
+	DBusMessageIter variant_iter = DBUS_MESSAGE_ITER_INIT_CLOSED;
+	const char* member = receiver.member_name;
+	int value_int;
+	int ret;
+
+	if (!dbus_message_iter_open_container(&context->batch_array, DBUS_TYPE_STRUCT, NULL, &struct_iter)
+		|| !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &member)) {
+		printf("Message Append Error: Out of Memory\n");
+		dbus_batch_abandon(context, &struct_iter, &variant_iter);
+		return -1;
+	}
+
+	switch (data.type) {
+	case DBUS_DATA_TYPE_STRING:
+		ret = dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_VARIANT, DBUS_TYPE_STRING_AS_STRING, &variant_iter)
+			&& dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_STRING, &data.value);
+		break;
+	case DBUS_DATA_TYPE_INT32:
+		value_int = atoi(data.value);
+		ret = dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_VARIANT, DBUS_TYPE_INT32_AS_STRING, &variant_iter)
+			&& dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_INT32, &value_int);
+		break;
+	default:
+		printf("Error: Unknown Argument Type\n");
+		dbus_batch_abandon(context, &struct_iter, &variant_iter);
+		return -1;
+	}
+
+	if (!ret
+		|| !dbus_message_iter_close_container(&struct_iter, &variant_iter)
+		|| !dbus_message_iter_close_container(&context->batch_array, &struct_iter)) {
+		printf("Message Append Error: Out of Memory\n");
+		dbus_batch_abandon(context, &struct_iter, &variant_iter);
+		return -1;
+	}
+
+	// 3.ﵽʱ
+	context->batch_count++;
+	context->batch_bytes += 16 + strlen(member) + (data.type == DBUS_DATA_TYPE_STRING ? strlen(data.value) : 0);
+	if (context->batch_count >= context->batch_policy.events || context->batch_bytes >= context->batch_policy.bytes) {
+		return dbus_batch_flush(context);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣر¼飬ǰŷ
+// 룺D-Bus
+// 
+// أ0-ɹûŷ⣩ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_batch_flush(DBUS_CONTEXT* context)
+{
+	if (!context->batch) {
+		return 0;
+	}
+
+	// 1.ر¼
+	if (!dbus_message_iter_close_container(&context->batch_iter, &context->batch_array)) {
+		printf("Message Append Error: Out of Memory\n");
+		dbus_batch_drop(context);
+		return -1;
+	}
+	dbus_batch_reset_iter(context);
+
+	// 2.뷢ͶУڼ仺棩
+	int ret = dbus_context_transmit(context, context->batch, NULL);
+	dbus_batch_drop(context);
+	dbus_context_update_timeout(context);
+
+	return ret;
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dbus/dbus.h>
+#ifdef DBUS_WITH_LZ4
+#include <lz4.h>
+#endif
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+static int compress_threshold = 0;
+static DBUS_COMPRESS_STATS compress_stats;
+
+
+////////////////////////////////////////////////////////////
+// ܣѹֵСڸóȵַѹ
+// 룺ֵֽڣ0-ѹ
+// 
+// أ0-ɹ -1-δѹ֧
+////////////////////////////////////////////////////////////
+int dbus_set_compression(int threshold)
+{
+#ifdef DBUS_WITH_LZ4
+	compress_threshold = threshold > 0 ? threshold : 0;
+	return 0;
+#else
+	if (threshold > 0) {
+		printf("Error: Compression Not Supported (build with LZ4=1)\n");
+		return -1;
+	}
+	compress_threshold = 0;
+	return 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡѹͳ
+// 룺
+// ͳݽṹ
+// أ
+////////////////////////////////////////////////////////////
+void dbus_get_compression_stats(DBUS_COMPRESS_STATS* stats)
+{
+	*stats = compress_stats;
+	stats->ratio = compress_stats.raw_bytes ? (double)compress_stats.compressed_bytes / compress_stats.raw_bytes : 1.0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׷ֵַʱѹΪ(yuay)뷽ʽԭʼȡѹ
+// 룺׷ӵַ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_append_string(DBusMessageIter* iter, const char* value)
+{
+#ifdef DBUS_WITH_LZ4
+	size_t length = strlen(value);
+
+	if (compress_threshold && length >= (size_t)compress_threshold && length <= DBUS_COMPRESS_MAX) {
+		// 1.ѹ
+		int capacity = LZ4_compressBound((int)length);
+		char* buffer = malloc(capacity);
+		if (!buffer) {
+			printf("Error: Out of Memory\n");
+			return -1;
+		}
+		int size = LZ4_compress_default(value, buffer, (int)length, capacity);
+
+		// 2.ѹЧʱԽṹ׷
+		if (size > 0 && (size_t)size < length) {
+			DBusMessageIter struct_iter;
+			DBusMessageIter array_iter;
+			unsigned char codec = DBUS_COMPRESS_LZ4;
+			dbus_uint32_t original = (dbus_uint32_t)length;
+			const char* data = buffer;
+
+			if (!dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &struct_iter)
+				|| !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_BYTE, &codec)
+				|| !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &original)
+				|| !dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_ARRAY, DBUS_TYPE_BYTE_AS_STRING, &array_iter)
+				|| !dbus_message_iter_append_fixed_array(&array_iter, DBUS_TYPE_BYTE, &data, size)
+				|| !dbus_message_iter_close_container(&struct_iter, &array_iter)
+				|| !dbus_message_iter_close_container(iter, &struct_iter)) {
+				printf("Message Append Error: Out of Memory\n");
+				free(buffer);
+				return -1;
+			}
+			free(buffer);
+
+			compress_stats.compressed++;
+			compress_stats.raw_bytes += length;
+			compress_stats.compressed_bytes += size;
+			return 0;
+		}
+		free(buffer);
+	}
+#endif
+
+	// 3.ѹ
+	if (!dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &value)) {
+		printf("Message Append Error: Out of Memory\n");
+		return -1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣѹ(yuay)ṹ
+// 룺ָṹĵNULL-ʹmalloc
+// 
+// أѹַδʹ÷ʱ÷freeNULL-ʧ
+////////////////////////////////////////////////////////////
+char* dbus_decompress_string(DBusMessageIter* iter, DBUS_ARENA* arena)
+{
+	// 1.Уṹǩ
+	char* signature = dbus_message_iter_get_signature(iter);
+	if (!signature) {
+		printf("Error: Out of Memory\n");
+		return NULL;
+	}
+	int valid = !strcmp(signature, DBUS_COMPRESS_SIGNATURE);
+	dbus_free(signature);
+	if (!valid) {
+		printf("Error: Unknown Argument Type\n");
+		return NULL;
+	}
+
+	// 2.ȡ뷽ʽԭʼȡѹ
+	DBusMessageIter struct_iter;
+	DBusMessageIter array_iter;
+	unsigned char codec;
+	dbus_uint32_t original;
+	const char* data;
+	int size;
+
+	dbus_message_iter_recurse(iter, &struct_iter);
+	dbus_message_iter_get_basic(&struct_iter, &codec);
+	dbus_message_iter_next(&struct_iter);
+	dbus_message_iter_get_basic(&struct_iter, &original);
+	dbus_message_iter_next(&struct_iter);
+	dbus_message_iter_recurse(&struct_iter, &array_iter);
+	dbus_message_iter_get_fixed_array(&array_iter, &data, &size);
+
+	if (codec != DBUS_COMPRESS_LZ4 || original > DBUS_COMPRESS_MAX) {
+		printf("Error: Unknown Compression\n");
+		return NULL;
+	}
+
+	// LZ4ѹȲ255ԭʼȳʱݱȻ𻵣Ϊڴ
+	if ((unsigned long long)original > (unsigned long long)size * 255 + 16) {
+		printf("Error: Corrupt Compressed Data\n");
+		return NULL;
+	}
+
+#ifdef DBUS_WITH_LZ4
+	// 3.ѹȱԭʼһ
+	char* value = arena ? dbus_arena_alloc(arena, original + 1) : malloc(original + 1);
+	if (!value) {
+		printf("Error: Out of Memory\n");
+		return NULL;
+	}
+	if (LZ4_decompress_safe(data, value, size, (int)original) != (int)original) {
+		printf("Error: Corrupt Compressed Data\n");
+		if (!arena) {
+			free(value);
+		}
+		return NULL;
+	}
+	value[original] = '\0';
+	if (!dbus_validate_utf8(value, NULL)) {
+		printf("Error: Corrupt Compressed Data\n");
+		if (!arena) {
+			free(value);
+		}
+		return NULL;
+	}
+
+	compress_stats.decompressed++;
+	return value;
+#else
+	(void)arena;
+	printf("Error: Compression Not Supported (build with LZ4=1)\n");
+	return NULL;
+#endif
+}
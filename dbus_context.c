@@ -0,0 +1,1108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+#define DBUS_WATCH_LOCAL	4		// ͬһϵļֵͨʱڴ
+#define DBUS_OWNER_RULE		"type='signal',sender='" DBUS_SERVICE_DBUS "',interface='" DBUS_INTERFACE_DBUS "',member='NameOwnerChanged'"
+
+
+
+////////////////////////////////////////////////////////////
+// ܣȡʱӣ룩
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+long long dbus_monotonic_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+////////////////////////////////////////////////////////////
+// ܣǼҪ¼б仯ʱ֪ͨ¼ѭ
+// 룺D-Busģ¼0-Ƴ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_watch_fd(DBUS_CONTEXT* context, int fd, unsigned int events)
+{
+	// 1.¼
+	int i;
+	for (i = 0; i < context->fd_count; i++) {
+		if (context->fds[i].fd == fd) {
+			break;
+		}
+	}
+	if (i < context->fd_count) {
+		if (context->fds[i].events == events) {
+			return;
+		}
+		if (events) {
+			context->fds[i].events = events;
+		}
+		else {
+			context->fds[i] = context->fds[--context->fd_count];
+		}
+	}
+	else {
+		if (!events) {
+			return;
+		}
+		DBUS_FD_RECORD* fds = realloc(context->fds, (context->fd_count + 1) * sizeof(DBUS_FD_RECORD));
+		if (!fds) {
+			printf("Error: Out of Memory\n");
+			return;
+		}
+		context->fds = fds;
+		context->fds[context->fd_count].fd = fd;
+		context->fds[context->fd_count].events = events;
+		context->fd_count++;
+	}
+
+	// 2.֪ͨ¼ѭ
+	if (context->watch_function) {
+		context->watch_function(fd, events, context->watch_data);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣ¼libdbusҪ¼ͬһϵļϲ
+// 룺D-Busģ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_context_update_fd(DBUS_CONTEXT* context, int fd)
+{
+	unsigned int events = 0;
+	int i;
+	for (i = 0; i < context->watch_count; i++) {
+		DBusWatch* watch = context->watches[i];
+		if (dbus_watch_get_unix_fd(watch) == fd && dbus_watch_get_enabled(watch)) {
+			events |= dbus_watch_get_flags(watch);
+		}
+	}
+
+	dbus_context_watch_fd(context, fd, events);
+}
+
+static dbus_bool_t dbus_context_add_watch(DBusWatch* watch, void* data)
+{
+	DBUS_CONTEXT* context = data;
+
+	DBusWatch** watches = realloc(context->watches, (context->watch_count + 1) * sizeof(DBusWatch*));
+	if (!watches) {
+		return FALSE;
+	}
+	context->watches = watches;
+	context->watches[context->watch_count++] = watch;
+
+	dbus_context_update_fd(context, dbus_watch_get_unix_fd(watch));
+	return TRUE;
+}
+
+static void dbus_context_remove_watch(DBusWatch* watch, void* data)
+{
+	DBUS_CONTEXT* context = data;
+
+	int i;
+	for (i = 0; i < context->watch_count; i++) {
+		if (context->watches[i] == watch) {
+			context->watches[i] = context->watches[--context->watch_count];
+			break;
+		}
+	}
+
+	dbus_context_update_fd(context, dbus_watch_get_unix_fd(watch));
+}
+
+static void dbus_context_toggle_watch(DBusWatch* watch, void* data)
+{
+	dbus_context_update_fd(data, dbus_watch_get_unix_fd(watch));
+}
+
+////////////////////////////////////////////////////////////
+// ܣ֪ͨ¼ѭһγʱʱ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_update_timeout(DBUS_CONTEXT* context)
+{
+	if (context->timeout_function) {
+		context->timeout_function(dbus_context_get_timeout(context), context->timeout_data);
+	}
+}
+
+static dbus_bool_t dbus_context_add_timeout(DBusTimeout* timeout, void* data)
+{
+	DBUS_CONTEXT* context = data;
+
+	DBUS_TIMEOUT_RECORD* timeouts = realloc(context->timeouts, (context->timeout_count + 1) * sizeof(DBUS_TIMEOUT_RECORD));
+	if (!timeouts) {
+		return FALSE;
+	}
+	context->timeouts = timeouts;
+	context->timeouts[context->timeout_count].timeout = timeout;
+	context->timeouts[context->timeout_count].deadline = dbus_monotonic_ms() + dbus_timeout_get_interval(timeout);
+	context->timeout_count++;
+
+	dbus_context_update_timeout(context);
+	return TRUE;
+}
+
+static void dbus_context_remove_timeout(DBusTimeout* timeout, void* data)
+{
+	DBUS_CONTEXT* context = data;
+
+	int i;
+	for (i = 0; i < context->timeout_count; i++) {
+		if (context->timeouts[i].timeout == timeout) {
+			context->timeouts[i] = context->timeouts[--context->timeout_count];
+			break;
+		}
+	}
+
+	dbus_context_update_timeout(context);
+}
+
+static void dbus_context_toggle_timeout(DBusTimeout* timeout, void* data)
+{
+	DBUS_CONTEXT* context = data;
+
+	int i;
+	for (i = 0; i < context->timeout_count; i++) {
+		if (context->timeouts[i].timeout == timeout) {
+			context->timeouts[i].deadline = dbus_monotonic_ms() + dbus_timeout_get_interval(timeout);
+			break;
+		}
+	}
+
+	dbus_context_update_timeout(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢ¼߶Ͽź뺯
+// 룺D-BusӣD-BusϢD-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+static DBusHandlerResult dbus_context_filter(DBusConnection* connection, DBusMessage* message, void* data)
+{
+	DBUS_CONTEXT* context = data;
+	(void)connection;
+
+	// 1.߶ϿַͷӲ
+	if (dbus_message_is_signal(message, DBUS_INTERFACE_LOCAL, "Disconnected")) {
+		context->disconnected = 1;
+		return DBUS_HANDLER_RESULT_HANDLED;
+	}
+
+	// 2.߱仯Զ˳ʱرչڴͨ
+	if (dbus_message_is_signal(message, DBUS_INTERFACE_DBUS, "NameOwnerChanged")) {
+		dbus_shm_name_changed(context, message);
+		dbus_stream_name_changed(context, message);
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	}
+
+	// 3.Ϣ󰴷ͷŶӣdbus_context_dispatch_readyת
+	if (!(context->flags & DBUS_CONTEXT_FLAG_RECEIVE)) {
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	}
+	if (dbus_limit_admit(context, message)) {
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+	}
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͷŵǰӣжػصÿѵǼǵ֪ͨƳ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_context_disconnect(DBUS_CONTEXT* context)
+{
+	if (!context->connection) {
+		return;
+	}
+
+	dbus_connection_set_watch_functions(context->connection, NULL, NULL, NULL, NULL, NULL);
+	dbus_connection_set_timeout_functions(context->connection, NULL, NULL, NULL, NULL, NULL);
+	dbus_connection_remove_filter(context->connection, dbus_context_filter, context);
+
+	dbus_connection_close(context->connection);
+	dbus_connection_unref(context->connection);
+	context->connection = NULL;
+}
+
+////////////////////////////////////////////////////////////
+// ܣӣߡעơȫϢɸѡ
+// 룺D-Bus
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_context_connect(DBUS_CONTEXT* context)
+{
+	// 1.ʼϢṹ
+	DBusError error;
+	dbus_error_init(&error);
+
+	// 2.ӵߣ˽ӣϿʱ˳̣
+	context->connection = dbus_bus_get_private(DBUS_BUS_SESSION, &error);
+	if (!context->connection) {
+		if (dbus_error_is_set(&error)) {
+			printf("Connect Bus Error: %s\n", error.message);
+			dbus_error_free(&error);
+		}
+		return -1;
+	}
+	dbus_connection_set_exit_on_disconnect(context->connection, FALSE);
+	context->disconnected = 0;
+
+	// 3.װϢԼʱص
+	if (!dbus_connection_add_filter(context->connection, dbus_context_filter, context, NULL)) {
+		printf("Error: Out of Memory\n");
+		dbus_connection_close(context->connection);
+		dbus_connection_unref(context->connection);
+		context->connection = NULL;
+		return -1;
+	}
+	if (!dbus_connection_set_watch_functions(context->connection, dbus_context_add_watch, dbus_context_remove_watch,
+			dbus_context_toggle_watch, context, NULL)
+		|| !dbus_connection_set_timeout_functions(context->connection, dbus_context_add_timeout, dbus_context_remove_timeout,
+			dbus_context_toggle_timeout, context, NULL)) {
+		printf("Error: Out of Memory\n");
+		dbus_context_disconnect(context);
+		return -1;
+	}
+
+	// 4.Ϊע
+	if (context->self.bus_name) {
+		int ret = dbus_bus_request_name(context->connection, context->self.bus_name, DBUS_NAME_FLAG_REPLACE_EXISTING, &error);
+		if (ret != DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+			if (dbus_error_is_set(&error)) {
+				printf("Connection Name Error: %s\n", error.message);
+				dbus_error_free(&error);
+			}
+			dbus_context_disconnect(context);
+			return -1;
+		}
+	}
+
+	// 5.Ϣʽɸѡ
+	int i;
+	for (i = 0; i < context->rule_count; i++) {
+		dbus_bus_add_match(context->connection, context->rules[i], &error);
+		if (dbus_error_is_set(&error)) {
+			printf("Match Error: %s\n", error.message);
+			dbus_error_free(&error);
+			dbus_context_disconnect(context);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣʧܽصͷŷصݽṹ
+// 룺صݽṹ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_context_reply_fail(DBUS_REPLY_CLOSURE* closure)
+{
+	DBUS_DATA result;
+	result.type = DBUS_DATA_TYPE_STRING;
+	result.value = NULL;
+
+	closure->function(-1, result, closure->user_data);
+	free(closure);
+}
+
+////////////////////////////////////////////////////////////
+// ܣڼ仺ĴϢ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_context_drop_outgoing(DBUS_CONTEXT* context)
+{
+	int i;
+	for (i = 0; i < context->outgoing_count; i++) {
+		dbus_message_unref(context->outgoing[i].message);
+		if (context->outgoing[i].closure) {
+			dbus_context_reply_fail(context->outgoing[i].closure);
+		}
+	}
+	context->outgoing_count = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣD-BusģߡעơϢɸѡ
+// 룺ݽṹ־λ
+// 
+// أD-BusģNULL-ʧ
+////////////////////////////////////////////////////////////
+DBUS_CONTEXT* dbus_context_open(DBUS_APPLICATION self, int flags)
+{
+	// 1.ʼ
+	DBUS_CONTEXT* context = calloc(1, sizeof(DBUS_CONTEXT));
+	if (!context) {
+		printf("Error: Out of Memory\n");
+		return NULL;
+	}
+	context->self = self;
+	context->flags = flags;
+	context->shutdown_fd = -1;
+	context->policy.delay = DBUS_RECONNECT_DELAY;
+	context->policy.delay_max = DBUS_RECONNECT_DELAY_MAX;
+	context->policy.attempts = 0;
+	context->policy.outgoing_max = DBUS_OUTGOING_MAX;
+	context->batch_policy.window = DBUS_BATCH_WINDOW;
+	context->batch_policy.events = 0;
+	context->batch_policy.bytes = DBUS_BATCH_BYTES;
+	context->stream_timeout = DBUS_STREAM_IDLE_TIMEOUT;
+
+	if (dbus_shutdown_init(context)) {
+		dbus_context_close(context);
+		return NULL;
+	}
+
+	// 2.ǼϢʽɸѡԶӣ
+	if (flags & DBUS_CONTEXT_FLAG_RECEIVE) {
+		char rule[128];
+		snprintf(rule, sizeof(rule), DBUS_SIGNAL_RULE, self.interface_name);
+		if (dbus_context_add_match(context, rule)) {
+			dbus_context_close(context);
+			return NULL;
+		}
+	}
+
+	// 3.
+	if (dbus_context_connect(context)) {
+		dbus_context_close(context);
+		return NULL;
+	}
+
+	return context;
+}
+
+////////////////////////////////////////////////////////////
+// ܣرD-Bus
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_close(DBUS_CONTEXT* context)
+{
+	if (!context) {
+		return;
+	}
+
+	// 1.δŷ⣬дͶкر
+	dbus_batch_flush(context);
+	if (dbus_context_is_connected(context)) {
+		dbus_connection_flush(context->connection);
+	}
+	dbus_context_disconnect(context);
+
+	// 2.ͷŻϢ¼ڴͨɸѡ
+	dbus_context_drop_outgoing(context);
+	dbus_stream_free(context);
+	dbus_limit_free(context);
+	dbus_shm_free(context);
+	dbus_arena_free(&context->arena);
+	dbus_shutdown_free(context);
+
+	int i;
+	for (i = 0; i < context->rule_count; i++) {
+		free(context->rules[i]);
+	}
+	free(context->rules);
+	free(context->outgoing);
+	free(context->watches);
+	free(context->fds);
+	free(context->timeouts);
+	free(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢʽɸѡԶ
+// 룺D-Busģɸѡ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_add_match(DBUS_CONTEXT* context, const char* rule)
+{
+	// 1.Ǽǹ
+	char** rules = realloc(context->rules, (context->rule_count + 1) * sizeof(char*));
+	if (!rules) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
+	context->rules = rules;
+	context->rules[context->rule_count] = strdup(rule);
+	if (!context->rules[context->rule_count]) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
+	context->rule_count++;
+
+	// 2.ʱ
+	if (context->connection) {
+		DBusError error;
+		dbus_error_init(&error);
+		dbus_bus_add_match(context->connection, rule, &error);
+		if (dbus_error_is_set(&error)) {
+			printf("Match Error: %s\n", error.message);
+			dbus_error_free(&error);
+			free(context->rules[--context->rule_count]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣע߱仯ڴͨãֻһΣ
+// 룺D-Bus
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_match_owners(DBUS_CONTEXT* context)
+{
+	if (context->owner_matched) {
+		return 0;
+	}
+	if (dbus_context_add_match(context, DBUS_OWNER_RULE)) {
+		return -1;
+	}
+	context->owner_matched = 1;
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣö
+// 룺D-Busģ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_set_reconnect_policy(DBUS_CONTEXT* context, DBUS_RECONNECT_POLICY policy)
+{
+	if (policy.delay <= 0) {
+		policy.delay = DBUS_RECONNECT_DELAY;
+	}
+	if (policy.delay_max < policy.delay) {
+		policy.delay_max = policy.delay;
+	}
+	context->policy = policy;
+}
+
+////////////////////////////////////////////////////////////
+// ܣѯǷӵ
+// 룺D-Bus
+// 
+// أ1- 0-Ͽ
+////////////////////////////////////////////////////////////
+int dbus_context_is_connected(DBUS_CONTEXT* context)
+{
+	return context->connection && !context->disconnected;
+}
+
+////////////////////////////////////////////////////////////
+// ܣԶ̺÷ʱص
+// 룺ĵãصݽṹ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_context_reply_notify(DBusPendingCall* pending, void* data)
+{
+	DBUS_REPLY_CLOSURE* closure = data;
+	DBUS_ARENA* arena = &closure->context->arena;
+	DBUS_DATA result;
+	DBUS_ARGS args;
+	int status = -1;
+
+	closure->context->calls--;
+
+	result.type = DBUS_DATA_TYPE_STRING;
+	result.value = NULL;
+
+	// 1.ȡ
+	DBusMessage* reply = dbus_pending_call_steal_reply(pending);
+	if (!reply) {
+		printf("Error: Reply Null\n");
+	}
+	else if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR) {
+		printf("Method Call Error: %s\n", dbus_message_get_error_name(reply));
+	}
+	else if (!dbus_decode_message(arena, reply, &args)) {
+		// 2.ĵһ
+		if (!args.count) {
+			printf("Error: Message Has No Argument\n");
+		}
+		else {
+			result = args.data[0];
+			status = 0;
+		}
+	}
+
+	// 3.ص
+	closure->function(status, result, closure->user_data);
+
+	dbus_arena_reset(arena);
+	if (reply) {
+		dbus_message_unref(reply);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢڼ仺棬˳򲹷
+// 룺D-BusģD-BusϢصݽṹNULL-Ҫ
+// 
+// أ0-ɹ -1-ʧܣʧʱصݽṹԹ÷У
+////////////////////////////////////////////////////////////
+int dbus_context_transmit(DBUS_CONTEXT* context, DBusMessage* message, DBUS_REPLY_CLOSURE* closure)
+{
+	// 1.ڼн绺
+	if (!context->connection) {
+		if (context->failed) {
+			printf("Error: Connection Lost\n");
+			return -1;
+		}
+		if (context->outgoing_count >= context->policy.outgoing_max) {
+			printf("Error: Outgoing Buffer Full\n");
+			return -1;
+		}
+		DBUS_OUTGOING_RECORD* outgoing = realloc(context->outgoing, (context->outgoing_count + 1) * sizeof(DBUS_OUTGOING_RECORD));
+		if (!outgoing) {
+			printf("Error: Out of Memory\n");
+			return -1;
+		}
+		context->outgoing = outgoing;
+		context->outgoing[context->outgoing_count].message = dbus_message_ref(message);
+		context->outgoing[context->outgoing_count].closure = closure;
+		context->outgoing_count++;
+		return 0;
+	}
+
+	// 2.Ҫʱֱ
+	if (!closure) {
+		if (!dbus_connection_send(context->connection, message, NULL)) {
+			printf("Send Error: Out of Memory\n");
+			return -1;
+		}
+		return 0;
+	}
+
+	// 3.ӲǼǷص
+	DBusPendingCall* pending;
+	if (!dbus_connection_send_with_reply(context->connection, message, &pending, DBUS_TIMEOUT_USE_DEFAULT) || !pending) {
+		printf("Method Call Send Error: Out of Memory\n");
+		return -1;
+	}
+	if (!dbus_pending_call_set_notify(pending, dbus_context_reply_notify, closure, free)) {
+		printf("Error: Out of Memory\n");
+		dbus_pending_call_cancel(pending);
+		dbus_pending_call_unref(pending);
+		return -1;
+	}
+	dbus_pending_call_unref(pending);
+	context->calls++;
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣʧʱָ˱ܰһ
+// 룺D-Bus
+// 
+// أ0- -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_context_reconnect(DBUS_CONTEXT* context)
+{
+	// 1.ԽӣעơϢɸѡ
+	context->reconnect_attempts++;
+	if (dbus_context_connect(context)) {
+		if (context->policy.attempts && context->reconnect_attempts >= context->policy.attempts) {
+			printf("Error: Reconnect Failed\n");
+			context->failed = 1;
+			context->reconnect_deadline = 0;
+			dbus_context_drop_outgoing(context);
+			return -1;
+		}
+		context->reconnect_delay = context->reconnect_delay * 2 < context->policy.delay_max ?
+			context->reconnect_delay * 2 : context->policy.delay_max;
+		context->reconnect_deadline = dbus_monotonic_ms() + context->reconnect_delay;
+		return -1;
+	}
+	printf("Bus Reconnected\n");
+	context->reconnect_deadline = 0;
+
+	// 2.˳򲹷ڼ仺Ϣ
+	int count = context->outgoing_count;
+	context->outgoing_count = 0;
+
+	int i;
+	for (i = 0; i < count; i++) {
+		DBUS_OUTGOING_RECORD record = context->outgoing[i];
+		if (dbus_context_transmit(context, record.message, record.closure) && record.closure) {
+			dbus_context_reply_fail(record.closure);
+		}
+		dbus_message_unref(record.message);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣǷϿϿʱͷӲ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_context_check_connection(DBUS_CONTEXT* context)
+{
+	if (!context->connection) {
+		return;
+	}
+	if (!context->disconnected && dbus_connection_get_is_connected(context->connection)) {
+		return;
+	}
+
+	printf("Error: Connection Lost\n");
+	dbus_context_disconnect(context);
+	dbus_limit_clear(context);
+
+	// ˳в
+	if (context->stopping) {
+		return;
+	}
+
+	context->reconnect_attempts = 0;
+	context->reconnect_delay = context->policy.delay;
+	context->reconnect_deadline = dbus_monotonic_ms() + context->reconnect_delay;
+	dbus_context_update_timeout(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣüص֪ͨǰѵǼǵ
+// 룺D-Busģصû
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_set_watch_function(DBUS_CONTEXT* context, DBUS_WATCH_FUNCTION function, void* user_data)
+{
+	context->watch_function = function;
+	context->watch_data = user_data;
+
+	int i;
+	for (i = 0; function && i < context->fd_count; i++) {
+		function(context->fds[i].fd, context->fds[i].events, user_data);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣöʱص֪ͨǰһγʱʱ
+// 룺D-Busģʱصû
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_set_timeout_function(DBUS_CONTEXT* context, DBUS_TIMEOUT_FUNCTION function, void* user_data)
+{
+	context->timeout_function = function;
+	context->timeout_data = user_data;
+
+	dbus_context_update_timeout(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣʱ̵ȴʱ䣨ѹʱΪ0
+// 룺ǰȴʱ䣨-1ʾ޶ʱʱ䣬ǰʱ
+// 
+// أµĵȴʱ
+////////////////////////////////////////////////////////////
+static long long dbus_context_earliest(long long interval, long long deadline, long long now)
+{
+	long long remain = deadline > now ? deadline - now : 0;
+	return interval < 0 || remain < interval ? remain : interval;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡһγʱʱ
+// 룺D-Bus
+// 
+// أ-1-޶ʱ
+////////////////////////////////////////////////////////////
+int dbus_context_get_timeout(DBUS_CONTEXT* context)
+{
+	long long now = dbus_monotonic_ms();
+	long long interval = -1;
+
+	// дϢʱȴڴͨΪʱǼǵȴѣ
+	if (context->queued || dbus_shm_pending(context)) {
+		return 0;
+	}
+
+	int i;
+	for (i = 0; i < context->timeout_count; i++) {
+		if (dbus_timeout_get_enabled(context->timeouts[i].timeout)) {
+			interval = dbus_context_earliest(interval, context->timeouts[i].deadline, now);
+		}
+	}
+
+	// ˳ŷⷢ͡
+	if (context->reconnect_deadline) {
+		interval = dbus_context_earliest(interval, context->reconnect_deadline, now);
+	}
+	if (context->drain_deadline) {
+		interval = dbus_context_earliest(interval, context->drain_deadline, now);
+	}
+	if (context->batch) {
+		interval = dbus_context_earliest(interval, context->batch_deadline, now);
+	}
+	long long deadline = dbus_stream_deadline(context);
+	if (deadline) {
+		interval = dbus_context_earliest(interval, deadline, now);
+	}
+
+	return (int)interval;
+}
+
+////////////////////////////////////////////////////////////
+// ܣϷ¼ȡд
+// 룺D-Busģ¼
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_handle_watch(DBUS_CONTEXT* context, int fd, unsigned int events)
+{
+	// ˳ڴͨĻ
+	if (!dbus_shutdown_handle_wakeup(context, fd) || !dbus_shm_handle_wakeup(context, fd)) {
+		return 0;
+	}
+
+	// 1.ҳϵļмܱƳȿ
+	DBusWatch* local[DBUS_WATCH_LOCAL];
+	DBusWatch** matched = local;
+	int count = 0;
+	int i, j;
+	for (i = 0; i < context->watch_count; i++) {
+		if (dbus_watch_get_unix_fd(context->watches[i]) == fd) {
+			count++;
+		}
+	}
+	if (count > DBUS_WATCH_LOCAL) {
+		matched = malloc(count * sizeof(DBusWatch*));
+		if (!matched) {
+			printf("Error: Out of Memory\n");
+			return -1;
+		}
+	}
+	count = 0;
+	for (i = 0; i < context->watch_count; i++) {
+		if (dbus_watch_get_unix_fd(context->watches[i]) == fd) {
+			matched[count++] = context->watches[i];
+		}
+	}
+
+	// 2.ȻЧõļ
+	int ret = 0;
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < context->watch_count; j++) {
+			if (context->watches[j] == matched[i]) {
+				break;
+			}
+		}
+		if (j == context->watch_count || !dbus_watch_get_enabled(matched[i])) {
+			continue;
+		}
+
+		unsigned int flags = events & (dbus_watch_get_flags(matched[i]) | DBUS_WATCH_ERROR | DBUS_WATCH_HANGUP);
+		if (flags && !dbus_watch_handle(matched[i], flags)) {
+			printf("Error: Out of Memory\n");
+			ret = -1;
+			break;
+		}
+	}
+
+	if (matched != local) {
+		free(matched);
+	}
+	return ret;
+}
+
+////////////////////////////////////////////////////////////
+// ܣѵڵĶʱŷⷢͣ
+// 룺D-Bus
+// 
+// أĶʱ
+////////////////////////////////////////////////////////////
+int dbus_context_handle_timeout(DBUS_CONTEXT* context)
+{
+	long long now = dbus_monotonic_ms();
+	int handled = 0;
+
+	// жʱܱɾÿһͷɨ
+	int i = 0;
+	while (i < context->timeout_count) {
+		DBUS_TIMEOUT_RECORD* record = &context->timeouts[i];
+		if (!dbus_timeout_get_enabled(record->timeout) || record->deadline > now) {
+			i++;
+			continue;
+		}
+
+		int interval = dbus_timeout_get_interval(record->timeout);
+		record->deadline = now + (interval > 0 ? interval : 1);
+		dbus_timeout_handle(record->timeout);
+		handled++;
+		i = 0;
+	}
+
+	// 
+	if (context->reconnect_deadline && context->reconnect_deadline <= now) {
+		dbus_context_reconnect(context);
+		handled++;
+	}
+
+	// ŷȴ
+	if (context->batch && context->batch_deadline <= now) {
+		dbus_batch_flush(context);
+		handled++;
+	}
+
+	// гʱ
+	handled += dbus_stream_expire(context);
+
+	if (handled) {
+		dbus_context_update_timeout(context);
+	}
+	return handled;
+}
+
+////////////////////////////////////////////////////////////
+// ܣַѶȡϢߣƽ˳
+// 룺D-Bus
+// 
+// أϢ
+////////////////////////////////////////////////////////////
+int dbus_context_dispatch_ready(DBUS_CONTEXT* context)
+{
+	int count = 0;
+
+	while (context->connection && dbus_connection_get_dispatch_status(context->connection) == DBUS_DISPATCH_DATA_REMAINS) {
+		dbus_connection_dispatch(context->connection);
+	}
+
+	// ͷתδޣʣ´
+	if (context->connection) {
+		count = dbus_limit_dispatch(context, DBUS_DISPATCH_BUDGET);
+	}
+	count += dbus_shm_dispatch(context, DBUS_DISPATCH_BUDGET);
+	dbus_context_check_connection(context);
+	dbus_shutdown_check(context);
+
+	return count;
+}
+
+////////////////////////////////////////////////////////////
+// ܣźţֻӣ¼ѭдڼ仺棩
+// 룺D-BusģշݽṹϢݽṹ
+// 
+// أ0-ɹ DBUS_SEND_RETRY-ڴͨԺԣ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_send_signal(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data)
+{
+	// շڴͨʱͨͨʱʧܣͨرպD-Bus
+	int ret = dbus_shm_send(context, receiver, data);
+	if (ret <= 0) {
+		return ret;
+	}
+
+	// ϲʱŷ
+	ret = dbus_batch_append(context, receiver, data);
+	if (ret <= 0) {
+		return ret;
+	}
+
+	// 1.D-BusϢ
+	DBusMessage* message = dbus_message_new_signal(receiver.object_path, receiver.interface_name, receiver.member_name);
+	if (!message) {
+		printf("Error: Signal Message NULL\n");
+		return -1;
+	}
+
+	// 2.D-BusϢ
+	if (dbus_append_data(message, data)) {
+		dbus_message_unref(message);
+		return -1;
+	}
+
+	// 3.뷢Ͷ
+	ret = dbus_context_transmit(context, message, NULL);
+	dbus_message_unref(message);
+
+	return ret;
+}
+
+////////////////////////////////////////////////////////////
+// ܣԶ̺ãͨصأ
+// 룺D-BusģշݽṹϢݽṹصΪNULLû
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_send_method_call(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data, DBUS_REPLY_FUNCTION function, void* user_data)
+{
+	// 1.D-BusϢ
+	DBusMessage* message = dbus_message_new_method_call(receiver.bus_name, receiver.object_path, receiver.interface_name, receiver.member_name);
+	if (!message) {
+		printf("Error: Method Call Message NULL\n");
+		return -1;
+	}
+
+	// 2.D-BusϢ
+	if (dbus_append_data(message, data)) {
+		dbus_message_unref(message);
+		return -1;
+	}
+
+	// 3.ķʱֱ
+	if (!function) {
+		dbus_message_set_no_reply(message, TRUE);
+		int ret = dbus_context_transmit(context, message, NULL);
+		dbus_message_unref(message);
+		return ret;
+	}
+
+	// 4.ӲǼǷص
+	DBUS_REPLY_CLOSURE* closure = malloc(sizeof(DBUS_REPLY_CLOSURE));
+	if (!closure) {
+		printf("Error: Out of Memory\n");
+		dbus_message_unref(message);
+		return -1;
+	}
+	closure->context = context;
+	closure->function = function;
+	closure->user_data = user_data;
+
+	if (dbus_context_transmit(context, message, closure)) {
+		dbus_message_unref(message);
+		free(closure);
+		return -1;
+	}
+	dbus_message_unref(message);
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ¼ѭpollֱdbus_context_quit˳
+// 룺D-Bus
+// 
+// أ0-˳ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_run(DBUS_CONTEXT* context)
+{
+	struct pollfd* fds = NULL;
+	int capacity = 0;
+	int count;
+	int ret = 0;
+	int i;
+
+	context->quit = 0;
+	dbus_context_dispatch_ready(context);
+
+	while (!context->quit) {
+		// 1.ϣ̶ӡ˳ѡڴͨ
+		if (context->fd_count > capacity) {
+			struct pollfd* grown = realloc(fds, context->fd_count * sizeof(struct pollfd));
+			if (!grown) {
+				printf("Error: Out of Memory\n");
+				ret = -1;
+				break;
+			}
+			fds = grown;
+			capacity = context->fd_count;
+		}
+		count = 0;
+		for (i = 0; i < context->fd_count; i++) {
+			fds[count].fd = context->fds[i].fd;
+			fds[count].events = 0;
+			fds[count].revents = 0;
+			if (context->fds[i].events & DBUS_WATCH_READABLE) {
+				fds[count].events |= POLLIN;
+			}
+			if (context->fds[i].events & DBUS_WATCH_WRITABLE) {
+				fds[count].events |= POLLOUT;
+			}
+			count++;
+		}
+
+		// 2.ȴ¼ʱ
+		if (poll(fds, count, dbus_context_get_timeout(context)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			printf("Poll Error: %s\n", strerror(errno));
+			ret = -1;
+			break;
+		}
+
+		// 3.¼붨ʱ
+		for (i = 0; i < count; i++) {
+			unsigned int events = 0;
+			if (fds[i].revents & POLLIN) {
+				events |= DBUS_EVENT_READABLE;
+			}
+			if (fds[i].revents & POLLOUT) {
+				events |= DBUS_EVENT_WRITABLE;
+			}
+			if (fds[i].revents & POLLERR) {
+				events |= DBUS_EVENT_ERROR;
+			}
+			if (fds[i].revents & POLLHUP) {
+				events |= DBUS_EVENT_HANGUP;
+			}
+			if (events && dbus_context_handle_watch(context, fds[i].fd, events)) {
+				ret = -1;
+				break;
+			}
+		}
+		if (ret) {
+			break;
+		}
+		dbus_context_handle_timeout(context);
+
+		// 4.ַϢ
+		dbus_context_dispatch_ready(context);
+		if (context->failed) {
+			ret = -1;
+			break;
+		}
+	}
+
+	free(fds);
+	return ret;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ֪ͨ¼ѭ˳
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_quit(DBUS_CONTEXT* context)
+{
+	context->quit = 1;
+}
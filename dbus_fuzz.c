@@ -0,0 +1,748 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+#define DBUS_FUZZ_WINDOW		32				// ͬʱȴĺø
+#define DBUS_FUZZ_OUTGOING		(4 * 1024 * 1024)	// дֽޣʱȴ
+#define DBUS_FUZZ_CHURN			5000			// ÿϢһӣµΨһƣ
+#define DBUS_FUZZ_STALL			5000			// ʱ䣨룩ûκηΪշֹͣӦ
+#define DBUS_FUZZ_DEPTH			3				// Ƕ
+#define DBUS_FUZZ_PATTERN		(1024 * 1024)	// ַ󳤶
+#define DBUS_FUZZ_RSS_SLACK		4096			// ĳפڴkB
+#define DBUS_FUZZ_FD_SLACK		4				// еϢЯ
+
+
+////////////////////////////////////////////////////////////
+// ÿһεͳ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_FUZZ_SAMPLE
+{
+	unsigned long long sent;		// ͵Ϣ
+	unsigned long long answered;	// յķ
+	unsigned long long errors;		// յĴ
+	long rss;						// շפڴ棨kB-1ʾδ֪
+	int fds;						// շ򿪵-1ʾδ֪
+
+}DBUS_FUZZ_SAMPLE;
+
+
+static unsigned int fuzz_seed;
+static char* fuzz_pattern = NULL;
+static char* fuzz_string = NULL;
+static int fuzz_pipe[2] = { -1, -1 };
+
+
+////////////////////////////////////////////////////////////
+// ܣ
+// 룺ޣ
+// 
+// أ[0, n)ڵ
+////////////////////////////////////////////////////////////
+static unsigned int dbus_fuzz_random(unsigned int n)
+{
+	unsigned int value = ((unsigned int)rand_r(&fuzz_seed) << 16) ^ (unsigned int)rand_r(&fuzz_seed);
+	return n ? value % n : value;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȣƫݣﵽ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+static unsigned int dbus_fuzz_size(void)
+{
+	unsigned int bucket = dbus_fuzz_random(100);
+	if (bucket < 60) {
+		return dbus_fuzz_random(64);
+	}
+	if (bucket < 90) {
+		return dbus_fuzz_random(4096);
+	}
+	if (bucket < 99) {
+		return dbus_fuzz_random(64 * 1024);
+	}
+	return dbus_fuzz_random(DBUS_FUZZ_PATTERN);
+}
+
+////////////////////////////////////////////////////////////
+// ܣַɴӡַJSONҪת뷴бܣ
+// 룺
+// 
+// أַ´εǰЧ
+////////////////////////////////////////////////////////////
+static const char* dbus_fuzz_text(unsigned int length)
+{
+	unsigned int offset = dbus_fuzz_random(DBUS_FUZZ_PATTERN - length + 1);
+	memcpy(fuzz_string, fuzz_pattern + offset, length);
+	fuzz_string[length] = '\0';
+	return fuzz_string;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׷αѹַ(yuay)뷽ʽԭʼȡݾ
+// 룺Ϣ
+// 
+// أ1-ɹ 0-ڴ治
+////////////////////////////////////////////////////////////
+static int dbus_fuzz_append_compressed(DBusMessageIter* iter)
+{
+	DBusMessageIter struct_iter;
+	DBusMessageIter array_iter;
+	unsigned char codec = dbus_fuzz_random(4) ? DBUS_COMPRESS_LZ4 : dbus_fuzz_random(256);
+	int size = dbus_fuzz_random(4096);
+	const dbus_uint32_t lengths[] = { 0, 1, size, size * 255 + 16, size * 255 + 17, DBUS_COMPRESS_MAX, 0xFFFFFFFF };
+	dbus_uint32_t original = lengths[dbus_fuzz_random(sizeof(lengths) / sizeof(lengths[0]))];
+	const char* data = fuzz_pattern + dbus_fuzz_random(DBUS_FUZZ_PATTERN - size);
+
+	return dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &struct_iter)
+		&& dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_BYTE, &codec)
+		&& dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT32, &original)
+		&& dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_ARRAY, DBUS_TYPE_BYTE_AS_STRING, &array_iter)
+		&& dbus_message_iter_append_fixed_array(&array_iter, DBUS_TYPE_BYTE, &data, size)
+		&& dbus_message_iter_close_container(&struct_iter, &array_iter)
+		&& dbus_message_iter_close_container(iter, &struct_iter);
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׷αĸٲ(ta(sut))׶θơ̺šʱ
+// 룺Ϣ
+// 
+// أ1-ɹ 0-ڴ治
+////////////////////////////////////////////////////////////
+static int dbus_fuzz_append_trace(DBusMessageIter* iter)
+{
+	DBusMessageIter struct_iter;
+	DBusMessageIter array_iter;
+	DBusMessageIter stage_iter;
+	dbus_uint64_t id = dbus_fuzz_random(4) ? dbus_fuzz_random(0) : 0;
+	unsigned int count = dbus_fuzz_random(DBUS_TRACE_STAGE_MAX * 2);
+	unsigned int i;
+
+	if (!dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &struct_iter)
+		|| !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &id)
+		|| !dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_ARRAY, "(sut)", &array_iter)) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		const char* name = dbus_fuzz_text(dbus_fuzz_random(DBUS_TRACE_NAME_MAX * 3));
+		dbus_uint32_t pid = dbus_fuzz_random(0);
+		dbus_uint64_t stamp = ((dbus_uint64_t)dbus_fuzz_random(0) << 32) | dbus_fuzz_random(0);
+
+		if (!dbus_message_iter_open_container(&array_iter, DBUS_TYPE_STRUCT, NULL, &stage_iter)
+			|| !dbus_message_iter_append_basic(&stage_iter, DBUS_TYPE_STRING, &name)
+			|| !dbus_message_iter_append_basic(&stage_iter, DBUS_TYPE_UINT32, &pid)
+			|| !dbus_message_iter_append_basic(&stage_iter, DBUS_TYPE_UINT64, &stamp)
+			|| !dbus_message_iter_close_container(&array_iter, &stage_iter)) {
+			return 0;
+		}
+	}
+
+	return dbus_message_iter_close_container(&struct_iter, &array_iter)
+		&& dbus_message_iter_close_container(iter, &struct_iter);
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׷һ͵Ĳݹɣ
+// 룺ϢǶ
+// 
+// أ1-ɹ 0-ڴ治
+////////////////////////////////////////////////////////////
+static int dbus_fuzz_append_random(DBusMessageIter* iter, int depth)
+{
+	static const char* signatures[] = { "", "s", "i", "ai", "a{sv}", DBUS_COMPRESS_SIGNATURE, DBUS_TRACE_SIGNATURE, DBUS_BATCH_SIGNATURE };
+	DBusMessageIter sub;
+	DBusMessageIter entry;
+	const char* value_str;
+	dbus_int32_t value_int;
+	dbus_uint64_t value_u64;
+	unsigned char value_byte;
+	dbus_bool_t value_bool;
+	double value_double;
+	char path[32];
+	unsigned int count;
+	unsigned int i;
+
+	switch (dbus_fuzz_random(depth < DBUS_FUZZ_DEPTH ? 15 : 10)) {
+	case 0:
+		value_str = dbus_fuzz_text(dbus_fuzz_size());
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_STRING, &value_str);
+	case 1:
+		value_int = (dbus_int32_t)dbus_fuzz_random(0);
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_INT32, &value_int);
+	case 2:
+		value_byte = dbus_fuzz_random(256);
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_BYTE, &value_byte);
+	case 3:
+		value_bool = dbus_fuzz_random(2);
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_BOOLEAN, &value_bool);
+	case 4:
+		value_u64 = ((dbus_uint64_t)dbus_fuzz_random(0) << 32) | dbus_fuzz_random(0);
+		return dbus_message_iter_append_basic(iter, dbus_fuzz_random(2) ? DBUS_TYPE_UINT64 : DBUS_TYPE_INT64, &value_u64);
+	case 5:
+		value_double = (double)(int)dbus_fuzz_random(0) / (dbus_fuzz_random(1000) + 1);
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_DOUBLE, &value_double);
+	case 6:
+		snprintf(path, sizeof(path), "/com/dbus/p%u", dbus_fuzz_random(1000));
+		value_str = path;
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_OBJECT_PATH, &value_str);
+	case 7:
+		value_str = signatures[dbus_fuzz_random(sizeof(signatures) / sizeof(signatures[0]))];
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_SIGNATURE, &value_str);
+	case 8:
+		count = dbus_fuzz_size();
+		value_str = fuzz_pattern + dbus_fuzz_random(DBUS_FUZZ_PATTERN - count);
+		return dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, DBUS_TYPE_BYTE_AS_STRING, &sub)
+			&& dbus_message_iter_append_fixed_array(&sub, DBUS_TYPE_BYTE, &value_str, count)
+			&& dbus_message_iter_close_container(iter, &sub);
+	case 9:
+		// շ֧֣Ϣͷ
+		if (fuzz_pipe[0] < 0) {
+			value_int = 0;
+			return dbus_message_iter_append_basic(iter, DBUS_TYPE_INT32, &value_int);
+		}
+		return dbus_message_iter_append_basic(iter, DBUS_TYPE_UNIX_FD, &fuzz_pipe[dbus_fuzz_random(2)]);
+	case 10:
+		// ַ
+		count = dbus_fuzz_random(64);
+		if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, DBUS_TYPE_STRING_AS_STRING, &sub)) {
+			return 0;
+		}
+		for (i = 0; i < count; i++) {
+			value_str = dbus_fuzz_text(dbus_fuzz_random(128));
+			if (!dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &value_str)) {
+				return 0;
+			}
+		}
+		return dbus_message_iter_close_container(iter, &sub);
+	case 11:
+		// ֵa{sv}ֵΪַ
+		count = dbus_fuzz_random(32);
+		if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sv}", &sub)) {
+			return 0;
+		}
+		for (i = 0; i < count; i++) {
+			DBusMessageIter variant_iter;
+			value_str = dbus_fuzz_text(dbus_fuzz_random(32));
+			value_int = (dbus_int32_t)dbus_fuzz_random(0);
+			if (!dbus_message_iter_open_container(&sub, DBUS_TYPE_DICT_ENTRY, NULL, &entry)
+				|| !dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &value_str)
+				|| !dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, DBUS_TYPE_INT32_AS_STRING, &variant_iter)
+				|| !dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_INT32, &value_int)
+				|| !dbus_message_iter_close_container(&entry, &variant_iter)
+				|| !dbus_message_iter_close_container(&sub, &entry)) {
+				return 0;
+			}
+		}
+		return dbus_message_iter_close_container(iter, &sub);
+	case 12:
+		// ṹ壨ǩɳԱ
+		count = dbus_fuzz_random(4) + 1;
+		if (!dbus_message_iter_open_container(iter, DBUS_TYPE_STRUCT, NULL, &sub)) {
+			return 0;
+		}
+		for (i = 0; i < count; i++) {
+			if (!dbus_fuzz_append_random(&sub, depth + 1)) {
+				return 0;
+			}
+		}
+		return dbus_message_iter_close_container(iter, &sub);
+	case 13:
+		return dbus_fuzz_append_compressed(iter);
+	case 14:
+		return dbus_fuzz_append_trace(iter);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ׷źŷa(sv)ԱƫԼ
+// 룺Ϣ
+// 
+// أ1-ɹ 0-ڴ治
+////////////////////////////////////////////////////////////
+static int dbus_fuzz_append_batch(DBusMessageIter* iter)
+{
+	static const char* variants[] = { "s", "i", "ay", "(si)", "as" };
+	DBusMessageIter array_iter;
+	DBusMessageIter struct_iter;
+	DBusMessageIter variant_iter;
+	DBusMessageIter sub;
+	unsigned int count = dbus_fuzz_random(DBUS_BATCH_EVENTS * 2);
+	unsigned int i;
+
+	if (!dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "(sv)", &array_iter)) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		const char* member = dbus_fuzz_random(4) ? DBUS_MEMBER_SIGNAL : dbus_fuzz_text(dbus_fuzz_random(16));
+		const char* signature = variants[dbus_fuzz_random(sizeof(variants) / sizeof(variants[0]))];
+		const char* value_str = dbus_fuzz_text(dbus_fuzz_random(256));
+		dbus_int32_t value_int = (dbus_int32_t)dbus_fuzz_random(0);
+		int ret;
+
+		if (!dbus_message_iter_open_container(&array_iter, DBUS_TYPE_STRUCT, NULL, &struct_iter)
+			|| !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &member)
+			|| !dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_VARIANT, signature, &variant_iter)) {
+			return 0;
+		}
+		switch (signature[0]) {
+		case 's':
+			ret = dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_STRING, &value_str);
+			break;
+		case 'i':
+			ret = dbus_message_iter_append_basic(&variant_iter, DBUS_TYPE_INT32, &value_int);
+			break;
+		case 'a':
+			ret = dbus_message_iter_open_container(&variant_iter, DBUS_TYPE_ARRAY, signature + 1, &sub)
+				&& (signature[1] == 'y' ? dbus_message_iter_append_fixed_array(&sub, DBUS_TYPE_BYTE, &value_str, strlen(value_str))
+					: dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &value_str))
+				&& dbus_message_iter_close_container(&variant_iter, &sub);
+			break;
+		default:
+			ret = dbus_message_iter_open_container(&variant_iter, DBUS_TYPE_STRUCT, NULL, &sub)
+				&& dbus_message_iter_append_basic(&sub, DBUS_TYPE_STRING, &value_str)
+				&& dbus_message_iter_append_basic(&sub, DBUS_TYPE_INT32, &value_int)
+				&& dbus_message_iter_close_container(&variant_iter, &sub);
+			break;
+		}
+		if (!ret
+			|| !dbus_message_iter_close_container(&struct_iter, &variant_iter)
+			|| !dbus_message_iter_close_container(&array_iter, &struct_iter)) {
+			return 0;
+		}
+	}
+
+	return dbus_message_iter_close_container(iter, &array_iter);
+}
+
+////////////////////////////////////////////////////////////
+// ܣһϢϢǩαѹ//ŷδ֪Ա
+// 룺շݽṹ
+// 
+// أD-BusϢNULL-ڴ治
+////////////////////////////////////////////////////////////
+static DBusMessage* dbus_fuzz_message(DBUS_APPLICATION receiver)
+{
+	static const char* members[] = { DBUS_MEMBER_SIGNAL, DBUS_MEMBER_METHOD, DBUS_MEMBER_BATCH, DBUS_MEMBER_SHM, "unknown" };
+	DBusMessageIter iter;
+	DBusMessage* message;
+	const char* member;
+	const char* value_str;
+	dbus_int32_t value_int;
+	unsigned int kind = dbus_fuzz_random(100);
+	unsigned int count;
+	unsigned int i;
+	int ret = 1;
+
+	// 1.ѡԱϢͣڴͨأͱ
+	if (kind < 20) {
+		member = dbus_fuzz_random(2) ? DBUS_MEMBER_SIGNAL : DBUS_MEMBER_METHOD;
+	}
+	else if (kind < 35) {
+		member = DBUS_MEMBER_BATCH;
+	}
+	else {
+		member = members[dbus_fuzz_random(sizeof(members) / sizeof(members[0]))];
+		if (!strcmp(member, DBUS_MEMBER_SHM) && dbus_fuzz_random(10)) {
+			member = DBUS_MEMBER_METHOD;
+		}
+	}
+
+	if (!strcmp(member, DBUS_MEMBER_SIGNAL) || !strcmp(member, DBUS_MEMBER_BATCH) || (kind >= 35 && dbus_fuzz_random(4) == 0)) {
+		message = dbus_message_new_signal(receiver.object_path, receiver.interface_name, member);
+	}
+	else {
+		message = dbus_message_new_method_call(receiver.bus_name, receiver.object_path, receiver.interface_name, member);
+	}
+	if (!message) {
+		return NULL;
+	}
+	dbus_message_iter_init_append(message, &iter);
+
+	// 2.ɲ
+	if (kind < 20) {
+		// ԼϢΪ׼
+		if (dbus_fuzz_random(2)) {
+			value_str = dbus_fuzz_text(dbus_fuzz_size());
+			ret = dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &value_str);
+		}
+		else {
+			value_int = (dbus_int32_t)dbus_fuzz_random(0);
+			ret = dbus_message_iter_append_basic(&iter, DBUS_TYPE_INT32, &value_int);
+		}
+	}
+	else if (kind < 35) {
+		ret = dbus_fuzz_append_batch(&iter);
+	}
+	else {
+		// ǩΪգαĸٲ
+		count = dbus_fuzz_random(7);
+		for (i = 0; ret && i < count; i++) {
+			ret = dbus_fuzz_append_random(&iter, 0);
+		}
+		if (ret && dbus_fuzz_random(8) == 0) {
+			ret = dbus_fuzz_append_trace(&iter);
+		}
+	}
+
+	if (!ret) {
+		dbus_message_unref(message);
+		return NULL;
+	}
+	return message;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡ̵ĳפڴ
+// 룺̺
+// δ֪ʱΪ-1
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_fuzz_probe(int target, DBUS_FUZZ_SAMPLE* sample)
+{
+	char path[64];
+	char line[256];
+
+	sample->rss = -1;
+	sample->fds = -1;
+	if (target <= 0) {
+		return;
+	}
+
+	// 1.פڴ
+	snprintf(path, sizeof(path), "/proc/%d/status", target);
+	FILE* file = fopen(path, "r");
+	if (file) {
+		while (fgets(line, sizeof(line), file)) {
+			if (!strncmp(line, "VmRSS:", 6)) {
+				sample->rss = atol(line + 6);
+				break;
+			}
+		}
+		fclose(file);
+	}
+
+	// 2.
+	snprintf(path, sizeof(path), "/proc/%d/fd", target);
+	DIR* dir = opendir(path);
+	if (dir) {
+		struct dirent* entry;
+		sample->fds = 0;
+		while ((entry = readdir(dir))) {
+			if (entry->d_name[0] != '.') {
+				sample->fds++;
+			}
+		}
+		closedir(dir);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣӣÿµΨһƣ
+// 룺
+// 
+// أD-BusӣNULL-ʧ
+////////////////////////////////////////////////////////////
+static DBusConnection* dbus_fuzz_connect(void)
+{
+	DBusError error;
+	dbus_error_init(&error);
+
+	DBusConnection* connection = dbus_bus_get_private(DBUS_BUS_SESSION, &error);
+	if (!connection) {
+		printf("Connect Bus Error: %s\n", dbus_error_is_set(&error) ? error.message : "unknown");
+		dbus_error_free(&error);
+		return NULL;
+	}
+	dbus_connection_set_exit_on_disconnect(connection, FALSE);
+	return connection;
+}
+
+////////////////////////////////////////////////////////////
+// ܣдӣͳյķ
+// 룺D-Busӣȴʱ䣨룩ȴĵøǰ
+// 
+// أ0-ɹ -1-ӶϿ
+////////////////////////////////////////////////////////////
+static int dbus_fuzz_pump(DBusConnection* connection, int timeout, int* outstanding, DBUS_FUZZ_SAMPLE* sample)
+{
+	if (!dbus_connection_read_write(connection, timeout)) {
+		return -1;
+	}
+
+	DBusMessage* message;
+	while ((message = dbus_connection_pop_message(connection))) {
+		switch (dbus_message_get_type(message)) {
+		case DBUS_MESSAGE_TYPE_ERROR:
+			sample->errors++;
+			// fall through
+		case DBUS_MESSAGE_TYPE_METHOD_RETURN:
+			// ߴΪصĴ󣨽շڡƵȣ
+			sample->answered++;
+			if (*outstanding > 0) {
+				(*outstanding)--;
+			}
+			break;
+		default:
+			break;
+		}
+		dbus_message_unref(message);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȴȫõõ
+// 룺D-Busӣȴĵøǰ
+// 
+// أ0-ȫ -1-շֹͣӦӶϿ
+////////////////////////////////////////////////////////////
+static int dbus_fuzz_settle(DBusConnection* connection, int* outstanding, DBUS_FUZZ_SAMPLE* sample)
+{
+	long long deadline = dbus_monotonic_ms() + DBUS_FUZZ_STALL;
+
+	while (*outstanding > 0) {
+		int before = *outstanding;
+		if (dbus_fuzz_pump(connection, 100, outstanding, sample)) {
+			return -1;
+		}
+		if (*outstanding < before) {
+			deadline = dbus_monotonic_ms() + DBUS_FUZZ_STALL;
+		}
+		else if (dbus_monotonic_ms() >= deadline) {
+			printf("Error: Receiver Stopped Replying, %d Calls Unanswered\n", *outstanding);
+			*outstanding = 0;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣÿ뷴볣פڴ桢ƽ/ֵ
+// 룺飬ֹ루ֹ
+// ÿ뷴ƽפڴ棬
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_fuzz_summarize(const DBUS_FUZZ_SAMPLE* samples, int from, int to, double* rate, long* rss, int* fds)
+{
+	int i;
+	long total = 0;
+
+	*rate = (double)(samples[to].answered - samples[from].answered) / (to - from);
+	*fds = -1;
+	for (i = from + 1; i <= to; i++) {
+		total += samples[i].rss;
+		if (samples[i].fds > *fds) {
+			*fds = samples[i].fds;
+		}
+	}
+	*rss = total / (to - from);
+}
+
+////////////////////////////////////////////////////////////
+// ܣշ/Ϣÿ¼շڴ桢
+//       ʱ飺շӦڴ½
+// 룺շݽṹʱ䣨룬4ӣշ̺ţ<=0ʱ
+// 
+// أ0-ͨ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_fuzz_run(DBUS_APPLICATION receiver, int seconds, unsigned int seed, int target)
+{
+	DBUS_FUZZ_SAMPLE* samples = NULL;
+	DBUS_FUZZ_SAMPLE current;
+	DBUS_FUZZ_SAMPLE start;
+	DBusConnection* connection = NULL;
+	int outstanding = 0;
+	int failed = 0;
+	int elapsed = 0;
+	unsigned int i;
+
+	if (seconds < 4) {
+		printf("Error: Fuzz Duration Must Be At Least 4 Seconds\n");
+		return -1;
+	}
+
+	// 1.׼
+	fuzz_seed = seed;
+	fuzz_pattern = malloc(DBUS_FUZZ_PATTERN);
+	fuzz_string = malloc(DBUS_FUZZ_PATTERN + 1);
+	samples = calloc(seconds + 1, sizeof(DBUS_FUZZ_SAMPLE));
+	if (!fuzz_pattern || !fuzz_string || !samples) {
+		printf("Error: Out of Memory\n");
+		failed = 1;
+		goto out;
+	}
+	for (i = 0; i < DBUS_FUZZ_PATTERN; i++) {
+		fuzz_pattern[i] = ' ' + dbus_fuzz_random('~' - ' ' + 1);
+	}
+
+	connection = dbus_fuzz_connect();
+	if (!connection) {
+		failed = 1;
+		goto out;
+	}
+	if (dbus_connection_can_send_type(connection, DBUS_TYPE_UNIX_FD) && pipe(fuzz_pipe)) {
+		fuzz_pipe[0] = fuzz_pipe[1] = -1;
+	}
+
+	memset(&current, 0, sizeof(current));
+	dbus_fuzz_probe(target, &start);
+	printf("[%d] Fuzzing %s for %ds, seed %u, receiver pid %d (rss %ld kB, fds %d)\n",
+		getpid(), receiver.bus_name, seconds, seed, target, start.rss, start.fds);
+
+	// 2.ͣÿ
+	unsigned long long begin = dbus_monotonic_ms();
+	unsigned long long next = begin + 1000;
+	unsigned long long stall = begin + DBUS_FUZZ_STALL;
+
+	while (elapsed < seconds) {
+		// 2.1 ȴĵùʱֻղʱûзΪֹͣӦ
+		int before = outstanding;
+		if (dbus_fuzz_pump(connection, outstanding >= DBUS_FUZZ_WINDOW ? 10 : 0, &outstanding, &current)) {
+			printf("Error: Connection Lost\n");
+			failed = 1;
+			break;
+		}
+		unsigned long long now = dbus_monotonic_ms();
+		if (outstanding < before || outstanding < DBUS_FUZZ_WINDOW) {
+			stall = now + DBUS_FUZZ_STALL;
+		}
+		else if (now >= stall) {
+			printf("Error: Receiver Stopped Replying, %d Calls Unanswered\n", outstanding);
+			failed = 1;
+			break;
+		}
+
+		// 2.2 
+		if (now >= next) {
+			elapsed++;
+			next += 1000;
+			dbus_fuzz_probe(target, &current);
+			samples[elapsed] = current;
+
+			const DBUS_FUZZ_SAMPLE* last = &samples[elapsed - 1];
+			printf("[%4ds] sent %llu/s  answered %llu/s (errors %llu)  rss %ld kB  fds %d\n", elapsed,
+				current.sent - last->sent, current.answered - last->answered, current.errors - last->errors,
+				current.rss, current.fds);
+			fflush(stdout);
+
+			// ˳󣨰δյĽʬ̣פڴ
+			if (target > 0 && current.rss < 0) {
+				printf("Error: Receiver Died\n");
+				failed = 1;
+				break;
+			}
+		}
+
+		// 2.3 ͣдݹʱд
+		if (outstanding >= DBUS_FUZZ_WINDOW || dbus_connection_get_outgoing_size(connection) > DBUS_FUZZ_OUTGOING) {
+			continue;
+		}
+		DBusMessage* message = dbus_fuzz_message(receiver);
+		if (!message) {
+			printf("Error: Out of Memory\n");
+			failed = 1;
+			break;
+		}
+		if (dbus_message_get_type(message) == DBUS_MESSAGE_TYPE_METHOD_CALL) {
+			outstanding++;
+		}
+		if (!dbus_connection_send(connection, message, NULL)) {
+			printf("Error: Out of Memory\n");
+			dbus_message_unref(message);
+			failed = 1;
+			break;
+		}
+		dbus_message_unref(message);
+		current.sent++;
+
+		// 2.4 ڻӣշҪɷͷ״̬¼ڴͨ
+		if (current.sent % DBUS_FUZZ_CHURN == 0) {
+			if (dbus_fuzz_settle(connection, &outstanding, &current)) {
+				failed = 1;
+				break;
+			}
+			dbus_connection_close(connection);
+			dbus_connection_unref(connection);
+			connection = dbus_fuzz_connect();
+			if (!connection) {
+				failed = 1;
+				break;
+			}
+		}
+	}
+
+	// 3.뷴Ͽȴշ
+	if (connection) {
+		if (!failed && dbus_fuzz_settle(connection, &outstanding, &current)) {
+			failed = 1;
+		}
+		dbus_connection_close(connection);
+		dbus_connection_unref(connection);
+	}
+	if (failed || target <= 0) {
+		goto out;
+	}
+	sleep(1);
+
+	// 4.飺ڶķ֮һ䣨Ԥȣķ֮һȽ
+	DBUS_FUZZ_SAMPLE end;
+	double warm_rate, last_rate;
+	long warm_rss, last_rss;
+	int warm_fds, last_fds;
+	int quarter = seconds / 4;
+
+	dbus_fuzz_probe(target, &end);
+	dbus_fuzz_summarize(samples, quarter, 2 * quarter, &warm_rate, &warm_rss, &warm_fds);
+	dbus_fuzz_summarize(samples, seconds - quarter, seconds, &last_rate, &last_rss, &last_fds);
+
+	printf("[%d] Sent %llu, Answered %llu (errors %llu)\n", getpid(), current.sent, current.answered, current.errors);
+	printf("[%d] Answered/s %.0f -> %.0f, RSS %ld -> %ld kB, fds %d -> %d (idle %d -> %d)\n", getpid(),
+		warm_rate, last_rate, warm_rss, last_rss, warm_fds, last_fds, start.fds, end.fds);
+
+	if (end.rss < 0 || end.fds < 0) {
+		printf("Error: Receiver Died\n");
+		failed = 1;
+	}
+	if (last_rss > warm_rss + DBUS_FUZZ_RSS_SLACK) {
+		printf("Error: Memory Leak Suspected\n");
+		failed = 1;
+	}
+	if (last_fds > warm_fds + DBUS_FUZZ_FD_SLACK || end.fds > start.fds) {
+		printf("Error: Descriptor Leak Suspected\n");
+		failed = 1;
+	}
+	if (last_rate < warm_rate / 2) {
+		printf("Error: Throughput Dropped\n");
+		failed = 1;
+	}
+	if (!failed) {
+		printf("[%d] Fuzz Passed\n", getpid());
+	}
+
+out:
+	if (fuzz_pipe[0] >= 0) {
+		close(fuzz_pipe[0]);
+		close(fuzz_pipe[1]);
+		fuzz_pipe[0] = fuzz_pipe[1] = -1;
+	}
+	free(samples);
+	free(fuzz_pattern);
+	free(fuzz_string);
+	fuzz_pattern = NULL;
+	fuzz_string = NULL;
+	return failed ? -1 : 0;
+}
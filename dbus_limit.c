@@ -0,0 +1,424 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+////////////////////////////////////////////////////////////
+// ܣϢԱӦ
+// 룺D-BusģԱ
+// 
+// أ±꣬-1-
+////////////////////////////////////////////////////////////
+static int dbus_limit_find_rule(DBUS_CONTEXT* context, const char* member)
+{
+	int fallback = -1;
+
+	int i;
+	for (i = 0; i < context->limit_count; i++) {
+		if (!context->limits[i].member) {
+			fallback = i;
+		}
+		else if (member && !strcmp(context->limits[i].member, member)) {
+			return i;
+		}
+	}
+
+	return fallback;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͷŷͷ¼
+// 룺ͷ¼
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_limit_free_sender(DBUS_SENDER_RECORD* sender)
+{
+	int i;
+	for (i = 0; i < sender->queue_count; i++) {
+		dbus_message_unref(sender->queue[(sender->queue_head + i) % DBUS_SENDER_QUEUE_MAX]);
+	}
+	free(sender->queue);
+	free(sender->buckets);
+	free(sender->name);
+}
+
+////////////////////////////////////////////////////////////
+// ܣ̭һʱ޴Ϣķͷ
+// 룺D-Bus
+// 
+// أ0-ɹ -1-ûп̭ķͷ
+////////////////////////////////////////////////////////////
+static int dbus_limit_evict(DBUS_CONTEXT* context)
+{
+	int victim = -1;
+
+	int i;
+	for (i = 0; i < context->sender_count; i++) {
+		if (context->senders[i].queue_count) {
+			continue;
+		}
+		if (victim < 0 || context->senders[i].active < context->senders[victim].active) {
+			victim = i;
+		}
+	}
+	if (victim < 0) {
+		return -1;
+	}
+
+	dbus_limit_free_sender(&context->senders[victim]);
+	context->senders[victim] = context->senders[--context->sender_count];
+	if (context->sender_next >= context->sender_count) {
+		context->sender_next = 0;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣҷͷ¼ʱ
+// 룺D-BusģͷΨһ
+// 
+// أͷ¼NULL-ʧ
+////////////////////////////////////////////////////////////
+static DBUS_SENDER_RECORD* dbus_limit_get_sender(DBUS_CONTEXT* context, const char* name)
+{
+	int i;
+	for (i = 0; i < context->sender_count; i++) {
+		if (!strcmp(context->senders[i].name, name)) {
+			return &context->senders[i];
+		}
+	}
+
+	// 1.¼ʱ̭зͷ
+	if (context->sender_count >= DBUS_SENDER_MAX && dbus_limit_evict(context)) {
+		return NULL;
+	}
+
+	// 2.¼
+	DBUS_SENDER_RECORD* senders = realloc(context->senders, (context->sender_count + 1) * sizeof(DBUS_SENDER_RECORD));
+	if (!senders) {
+		return NULL;
+	}
+	context->senders = senders;
+
+	DBUS_SENDER_RECORD* sender = &context->senders[context->sender_count];
+	memset(sender, 0, sizeof(DBUS_SENDER_RECORD));
+	sender->name = strdup(name);
+	sender->queue = malloc(DBUS_SENDER_QUEUE_MAX * sizeof(DBusMessage*));
+	if (!sender->name || !sender->queue) {
+		free(sender->name);
+		free(sender->queue);
+		return NULL;
+	}
+	context->sender_count++;
+
+	return sender;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͰȡһ
+// 룺D-Busģͷ¼±
+// 
+// أ0-ɹ -1-ʻڴ治㣨ܾ
+////////////////////////////////////////////////////////////
+static int dbus_limit_take_token(DBUS_CONTEXT* context, DBUS_SENDER_RECORD* sender, int rule)
+{
+	long long now = dbus_monotonic_ms();
+
+	// 1.ڷͷ֮ʱͰ
+	if (sender->bucket_count < context->limit_count) {
+		DBUS_BUCKET* buckets = realloc(sender->buckets, context->limit_count * sizeof(DBUS_BUCKET));
+		if (!buckets) {
+			printf("Error: Out of Memory\n");
+			return -1;
+		}
+		int i;
+		for (i = sender->bucket_count; i < context->limit_count; i++) {
+			buckets[i].tokens = context->limits[i].burst;
+			buckets[i].last = now;
+		}
+		sender->buckets = buckets;
+		sender->bucket_count = context->limit_count;
+	}
+
+	// 2.ʱ䲹
+	DBUS_LIMIT_RULE* limit = &context->limits[rule];
+	DBUS_BUCKET* bucket = &sender->buckets[rule];
+	bucket->tokens += (now - bucket->last) * limit->rate / 1000.0;
+	if (bucket->tokens > limit->burst) {
+		bucket->tokens = limit->burst;
+	}
+	bucket->last = now;
+
+	// 3.ȡ
+	if (bucket->tokens < 1.0) {
+		return -1;
+	}
+	bucket->tokens -= 1.0;
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣܾϢ÷شźֱӶ
+// 룺D-BusģD-BusϢƣ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_limit_reject(DBUS_CONTEXT* context, DBusMessage* message, const char* name, const char* reason)
+{
+	if (dbus_message_get_type(message) != DBUS_MESSAGE_TYPE_METHOD_CALL || dbus_message_get_no_reply(message)) {
+		return;
+	}
+
+	DBusMessage* reply = dbus_message_new_error(message, name, reason);
+	if (!reply) {
+		printf("Error: Out of Memory\n");
+		return;
+	}
+	if (!dbus_connection_send(context->connection, reply, NULL)) {
+		printf("Error: Out of Memory\n");
+	}
+	dbus_message_unref(reply);
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢͷ
+// 룺D-BusģD-BusϢ
+// 
+// أ0-ѽջѾܾ -1-ǱϢ
+////////////////////////////////////////////////////////////
+int dbus_limit_admit(DBUS_CONTEXT* context, DBusMessage* message)
+{
+	// 1.ȶϢĿַ
+	const char* path = dbus_message_get_path(message);
+	if (!path || strcmp(path, context->self.object_path)) {
+		return -1;
+	}
+
+	// 2.˳вٽϢ
+	if (context->stopping) {
+		dbus_limit_reject(context, message, DBUS_ERROR_NO_SERVER, "Service is shutting down");
+		return 0;
+	}
+
+	// 3.ҷͷ
+	const char* name = dbus_message_get_sender(message);
+	DBUS_SENDER_RECORD* sender = dbus_limit_get_sender(context, name ? name : "");
+	if (!sender) {
+		context->stats.overflowed++;
+		dbus_limit_reject(context, message, DBUS_ERROR_LIMITS_EXCEEDED, "Too many senders");
+		return 0;
+	}
+	sender->active = dbus_monotonic_ms();
+
+	// 4.Ա
+	int rule = dbus_limit_find_rule(context, dbus_message_get_member(message));
+	if (rule >= 0 && dbus_limit_take_token(context, sender, rule)) {
+		sender->stats.throttled++;
+		context->stats.throttled++;
+		dbus_limit_reject(context, message, DBUS_ERROR_LIMITS_EXCEEDED, "Rate limit exceeded");
+		return 0;
+	}
+
+	// 5.
+	if (sender->queue_count >= DBUS_SENDER_QUEUE_MAX) {
+		sender->stats.overflowed++;
+		context->stats.overflowed++;
+		dbus_limit_reject(context, message, DBUS_ERROR_LIMITS_EXCEEDED, "Too many pending requests");
+		return 0;
+	}
+	dbus_trace_arrive(message);
+	sender->queue[(sender->queue_head + sender->queue_count) % DBUS_SENDER_QUEUE_MAX] = dbus_message_ref(message);
+	sender->queue_count++;
+	sender->stats.accepted++;
+	context->stats.accepted++;
+	context->queued++;
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͷתϢÿͷÿһ
+// 룺D-BusģദϢ
+// 
+// أϢ
+////////////////////////////////////////////////////////////
+int dbus_limit_dispatch(DBUS_CONTEXT* context, int budget)
+{
+	int count = 0;
+	int idle = 0;
+
+	while (context->queued && count < budget && idle < context->sender_count) {
+		// 1.ֵķͷ
+		if (context->sender_next >= context->sender_count) {
+			context->sender_next = 0;
+		}
+		DBUS_SENDER_RECORD* sender = &context->senders[context->sender_next++];
+		if (!sender->queue_count) {
+			idle++;
+			continue;
+		}
+		idle = 0;
+
+		// 2.ȡһϢ
+		DBusMessage* message = sender->queue[sender->queue_head];
+		sender->queue_head = (sender->queue_head + 1) % DBUS_SENDER_QUEUE_MAX;
+		sender->queue_count--;
+		context->queued--;
+
+		dbus_process_message(context, message);
+		dbus_message_unref(message);
+		count++;
+	}
+
+	return count;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȫϢӶϿʱ÷յ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_limit_clear(DBUS_CONTEXT* context)
+{
+	int i, j;
+	for (i = 0; i < context->sender_count; i++) {
+		DBUS_SENDER_RECORD* sender = &context->senders[i];
+		for (j = 0; j < sender->queue_count; j++) {
+			dbus_message_unref(sender->queue[(sender->queue_head + j) % DBUS_SENDER_QUEUE_MAX]);
+		}
+		sender->queue_head = 0;
+		sender->queue_count = 0;
+	}
+	context->queued = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣܾȫϢ÷شźֱӶ
+// 룺D-Busģƣ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_limit_reject_pending(DBUS_CONTEXT* context, const char* name, const char* reason)
+{
+	int i, j;
+	for (i = 0; i < context->sender_count; i++) {
+		DBUS_SENDER_RECORD* sender = &context->senders[i];
+		for (j = 0; j < sender->queue_count; j++) {
+			DBusMessage* message = sender->queue[(sender->queue_head + j) % DBUS_SENDER_QUEUE_MAX];
+			if (context->connection) {
+				dbus_limit_reject(context, message, name, reason);
+			}
+			dbus_message_unref(message);
+		}
+		sender->queue_head = 0;
+		sender->queue_count = 0;
+	}
+	context->queued = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͷ뷢ͷ¼
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_limit_free(DBUS_CONTEXT* context)
+{
+	int i;
+	for (i = 0; i < context->sender_count; i++) {
+		dbus_limit_free_sender(&context->senders[i]);
+	}
+	for (i = 0; i < context->limit_count; i++) {
+		free(context->limits[i].member);
+	}
+	free(context->senders);
+	free(context->limits);
+	context->senders = NULL;
+	context->sender_count = 0;
+	context->limits = NULL;
+	context->limit_count = 0;
+	context->queued = 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣÿͷָԱޣͰ
+// 룺D-BusģԱƣNULL-ĬϹ򣩣ÿʣͻ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_set_rate_limit(DBUS_CONTEXT* context, const char* member, double rate, double burst)
+{
+	if (rate <= 0 || burst < 1) {
+		printf("Error: Invalid Rate Limit\n");
+		return -1;
+	}
+
+	// 1.йֱ޸
+	int i;
+	for (i = 0; i < context->limit_count; i++) {
+		DBUS_LIMIT_RULE* limit = &context->limits[i];
+		if ((!member && !limit->member) || (member && limit->member && !strcmp(member, limit->member))) {
+			limit->rate = rate;
+			limit->burst = burst;
+			return 0;
+		}
+	}
+
+	// 2.ӹ
+	DBUS_LIMIT_RULE* limits = realloc(context->limits, (context->limit_count + 1) * sizeof(DBUS_LIMIT_RULE));
+	if (!limits) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
+	context->limits = limits;
+
+	DBUS_LIMIT_RULE* limit = &context->limits[context->limit_count];
+	limit->member = NULL;
+	if (member) {
+		limit->member = strdup(member);
+		if (!limit->member) {
+			printf("Error: Out of Memory\n");
+			return -1;
+		}
+	}
+	limit->rate = rate;
+	limit->burst = burst;
+	context->limit_count++;
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡͳƣȫͷϼƣ
+// 룺D-Bus
+// ͳݽṹ
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_get_limit_stats(DBUS_CONTEXT* context, DBUS_LIMIT_STATS* stats)
+{
+	*stats = context->stats;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡָͷͳ
+// 룺D-BusģͷΨһ
+// ͳݽṹ
+// أ0-ɹ -1-޸÷ͷ¼
+////////////////////////////////////////////////////////////
+int dbus_context_get_sender_stats(DBUS_CONTEXT* context, const char* sender, DBUS_LIMIT_STATS* stats)
+{
+	int i;
+	for (i = 0; i < context->sender_count; i++) {
+		if (!strcmp(context->senders[i].name, sender)) {
+			*stats = context->senders[i].stats;
+			return 0;
+		}
+	}
+
+	return -1;
+}
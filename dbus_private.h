@@ -0,0 +1,314 @@
+#ifndef DBUS_PRIVATE_H_
+#define DBUS_PRIVATE_H_
+
+
+#include <signal.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+
+
+////////////////////////////////////////////////////////////
+// ļ¼ͬһϵĶдϲ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_FD_RECORD
+{
+	int fd;
+	unsigned int events;
+
+}DBUS_FD_RECORD;
+
+////////////////////////////////////////////////////////////
+// ʱ¼
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_TIMEOUT_RECORD
+{
+	DBusTimeout* timeout;
+	long long deadline;
+
+}DBUS_TIMEOUT_RECORD;
+
+////////////////////////////////////////////////////////////
+// ڼ仺ĴϢclosureǿձʾҪ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_OUTGOING_RECORD
+{
+	DBusMessage* message;
+	void* closure;
+
+}DBUS_OUTGOING_RECORD;
+
+////////////////////////////////////////////////////////////
+// memberΪNULLʾĬϹ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_LIMIT_RULE
+{
+	char* member;
+	double rate;
+	double burst;
+
+}DBUS_LIMIT_RULE;
+
+////////////////////////////////////////////////////////////
+// Ͱ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_BUCKET
+{
+	double tokens;
+	long long last;
+
+}DBUS_BUCKET;
+
+////////////////////////////////////////////////////////////
+// ͷ¼ͰСͳƣ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_SENDER_RECORD
+{
+	char* name;
+	DBUS_BUCKET* buckets;
+	int bucket_count;
+	DBusMessage** queue;
+	int queue_head;
+	int queue_count;
+	long long active;
+	DBUS_LIMIT_STATS stats;
+
+}DBUS_SENDER_RECORD;
+
+////////////////////////////////////////////////////////////
+// ڴͨͷߵߣλֻ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_SHM_HEADER
+{
+	unsigned int magic;
+	unsigned int capacity;
+	unsigned int closed;
+	unsigned long long head __attribute__((aligned(64)));		// λ
+	unsigned long long tail __attribute__((aligned(64)));		// λ
+	unsigned int waiting __attribute__((aligned(64)));		// ߵȴ
+
+}DBUS_SHM_HEADER;
+
+////////////////////////////////////////////////////////////
+// ڴͨproducerΪ1ʾǷͷ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_SHM_RING
+{
+	char* peer;
+	int producer;
+	DBUS_SHM_HEADER* header;
+	char* data;
+	size_t size;
+	int eventfd;
+
+}DBUS_SHM_RING;
+
+////////////////////////////////////////////////////////////
+// Զ̺÷صݽṹ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_REPLY_CLOSURE
+{
+	DBUS_CONTEXT* context;
+	DBUS_REPLY_FUNCTION function;
+	void* user_data;
+
+}DBUS_REPLY_CLOSURE;
+
+////////////////////////////////////////////////////////////
+// շÿһһϢãֻһ߳ʹã
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_ARENA
+{
+	char* base;
+	size_t size;
+	size_t used;
+	char* chunks;		// ʱʱĶ
+	size_t overflow;
+
+}DBUS_ARENA;
+
+////////////////////////////////////////////////////////////
+// ٽ׶ΣƱʾý׶νʱΪCLOCK_MONOTONIC룬ͬһڿ̿ɱȣ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_TRACE_STAGE
+{
+	char name[DBUS_TRACE_NAME_MAX];
+	unsigned int pid;
+	unsigned long long stamp;
+
+}DBUS_TRACE_STAGE;
+
+////////////////////////////////////////////////////////////
+// Ϣټ¼idΪ0ʾ٣
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_TRACE
+{
+	unsigned long long id;
+	int count;
+	DBUS_TRACE_STAGE stages[DBUS_TRACE_STAGE_MAX];
+
+}DBUS_TRACE;
+
+////////////////////////////////////////////////////////////
+// ƬinboundΪ1ʾǽշ
+////////////////////////////////////////////////////////////
+struct _DBUS_STREAM
+{
+	DBUS_CONTEXT* context;
+	int inbound;
+	char* peer;						// շƣͷͷΨһƣշ
+	char* path;
+	char* interface;
+	char* name;
+	dbus_uint32_t id;				// ͷ䣬뷢ͷһʶ
+	dbus_uint64_t size;
+	dbus_uint64_t offset;			// д루ͷѽգշֽ
+	dbus_uint32_t seq;				// һƬ
+	long long active;				// һյϢʱ䣨շ
+	int state;
+	int inflight;					// ȴȷϵĵø
+	int close_sent;
+	char* chunk;					// ķƬ
+	size_t chunk_used;
+	DBUS_STREAM_SINK sink;
+	DBUS_STREAM_FUNCTION function;
+	void* user_data;
+};
+
+////////////////////////////////////////////////////////////
+// D-Busݽṹ
+////////////////////////////////////////////////////////////
+struct _DBUS_CONTEXT
+{
+	DBUS_APPLICATION self;
+	int flags;
+	DBusConnection* connection;
+
+	char** rules;
+	int rule_count;
+
+	DBUS_RECONNECT_POLICY policy;
+	int disconnected;
+	int failed;
+	int reconnect_delay;
+	int reconnect_attempts;
+	long long reconnect_deadline;
+
+	DBUS_OUTGOING_RECORD* outgoing;
+	int outgoing_count;
+	int calls;				// ѷδصĺ
+
+	DBUS_LIMIT_RULE* limits;
+	int limit_count;
+	DBUS_SENDER_RECORD* senders;
+	int sender_count;
+	int sender_next;
+	int queued;
+	DBUS_LIMIT_STATS stats;
+
+	DBUS_SHM_RING* rings;
+	int ring_count;
+	int ring_next;
+	int owner_matched;
+	char* scratch;
+	size_t scratch_size;
+
+	DBUS_ARENA arena;
+
+	DBUS_STREAM** streams;
+	int stream_count;
+	dbus_uint32_t stream_next_id;
+	DBUS_STREAM_ACCEPT_FUNCTION stream_function;
+	void* stream_data;
+	int stream_timeout;
+
+	DBUS_BATCH_POLICY batch_policy;
+	DBusMessage* batch;
+	DBusMessageIter batch_iter;
+	DBusMessageIter batch_array;
+	char* batch_path;
+	char* batch_interface;
+	int batch_count;
+	int batch_bytes;
+	long long batch_deadline;
+
+	DBusWatch** watches;
+	int watch_count;
+	DBUS_FD_RECORD* fds;
+	int fd_count;
+	DBUS_TIMEOUT_RECORD* timeouts;
+	int timeout_count;
+
+	DBUS_WATCH_FUNCTION watch_function;
+	void* watch_data;
+	DBUS_TIMEOUT_FUNCTION timeout_function;
+	void* timeout_data;
+
+	int shutdown_fd;
+	volatile sig_atomic_t shutdown_requested;
+	int stopping;
+	int drained;
+	int drain_timeout;
+	long long drain_deadline;
+
+	int quit;
+};
+
+
+long long dbus_monotonic_ms(void);
+DBusConnection* dbus_connect_bus(DBusError* error);
+int dbus_append_data(DBusMessage* message, DBUS_DATA data);
+int dbus_append_string(DBusMessageIter* iter, const char* value);
+char* dbus_decompress_string(DBusMessageIter* iter, DBUS_ARENA* arena);
+int dbus_process_message(DBUS_CONTEXT* context, DBusMessage* message);
+void dbus_handle_signal(DBUS_CONTEXT* context, DBUS_DATA data);
+void dbus_context_watch_fd(DBUS_CONTEXT* context, int fd, unsigned int events);
+void dbus_context_update_timeout(DBUS_CONTEXT* context);
+int dbus_context_match_owners(DBUS_CONTEXT* context);
+int dbus_context_transmit(DBUS_CONTEXT* context, DBusMessage* message, DBUS_REPLY_CLOSURE* closure);
+
+int dbus_limit_admit(DBUS_CONTEXT* context, DBusMessage* message);
+int dbus_limit_dispatch(DBUS_CONTEXT* context, int budget);
+void dbus_limit_clear(DBUS_CONTEXT* context);
+void dbus_limit_reject(DBUS_CONTEXT* context, DBusMessage* message, const char* name, const char* reason);
+void dbus_limit_reject_pending(DBUS_CONTEXT* context, const char* name, const char* reason);
+void dbus_limit_free(DBUS_CONTEXT* context);
+
+int dbus_shm_accept(DBUS_CONTEXT* context, DBusMessage* message);
+int dbus_shm_send(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data);
+int dbus_shm_pending(DBUS_CONTEXT* context);
+int dbus_shm_dispatch(DBUS_CONTEXT* context, int budget);
+int dbus_shm_handle_wakeup(DBUS_CONTEXT* context, int fd);
+void dbus_shm_name_changed(DBUS_CONTEXT* context, DBusMessage* message);
+void dbus_shm_stop(DBUS_CONTEXT* context);
+void dbus_shm_free(DBUS_CONTEXT* context);
+
+int dbus_shutdown_init(DBUS_CONTEXT* context);
+int dbus_shutdown_handle_wakeup(DBUS_CONTEXT* context, int fd);
+void dbus_shutdown_check(DBUS_CONTEXT* context);
+void dbus_shutdown_free(DBUS_CONTEXT* context);
+
+int dbus_stream_handle(DBUS_CONTEXT* context, DBusMessage* message);
+void dbus_stream_name_changed(DBUS_CONTEXT* context, DBusMessage* message);
+long long dbus_stream_deadline(DBUS_CONTEXT* context);
+int dbus_stream_expire(DBUS_CONTEXT* context);
+void dbus_stream_free(DBUS_CONTEXT* context);
+
+int dbus_batch_append(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data);
+int dbus_batch_flush(DBUS_CONTEXT* context);
+
+void* dbus_arena_alloc(DBUS_ARENA* arena, size_t size);
+void dbus_arena_reset(DBUS_ARENA* arena);
+void dbus_arena_free(DBUS_ARENA* arena);
+int dbus_decode_message(DBUS_ARENA* arena, DBusMessage* message, DBUS_ARGS* args);
+
+void dbus_trace_begin(DBUS_TRACE* trace);
+void dbus_trace_mark(DBUS_TRACE* trace, const char* name);
+int dbus_trace_append(DBusMessage* message, DBUS_TRACE* trace);
+int dbus_trace_extract(DBusMessage* message, DBUS_TRACE* trace);
+int dbus_trace_is_header(DBusMessageIter* iter);
+void dbus_trace_arrive(DBusMessage* message);
+void dbus_trace_merge(DBUS_TRACE* trace, const DBUS_TRACE* remote);
+void dbus_trace_write(const DBUS_TRACE* trace, const char* member);
+
+
+#endif // !DBUS_PRIVATE_H_
@@ -0,0 +1,591 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+#define DBUS_SHM_MAGIC			0x44425553		// "DBUS"
+#define DBUS_SHM_RECORD_PAD		0				// ¼ͨʼ
+#define DBUS_SHM_ALIGN(n)		(((n) + 7) & ~7ULL)
+#define DBUS_SHM_CAPACITY(size)	(((size) - sizeof(DBUS_SHM_HEADER)) & ~7ULL)	// ӳСó
+
+
+////////////////////////////////////////////////////////////
+// ͨ¼ͷlengthֽڵ
+////////////////////////////////////////////////////////////
+typedef struct _DBUS_SHM_RECORD
+{
+	unsigned int length;
+	unsigned int type;		// DBUS_DATA_TYPE + 10Ϊ¼
+
+}DBUS_SHM_RECORD;
+
+
+////////////////////////////////////////////////////////////
+// ܣرչڴͨƳ
+// 룺D-Busģͨ±
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_shm_close(DBUS_CONTEXT* context, int index)
+{
+	DBUS_SHM_RING* ring = &context->rings[index];
+
+	if (!ring->producer) {
+		// ֪ͨͷͨѹرգ֮Ϣ˻D-Bus
+		__atomic_store_n(&ring->header->closed, 1, __ATOMIC_RELEASE);
+		dbus_context_watch_fd(context, ring->eventfd, 0);
+	}
+	munmap(ring->header, ring->size);
+	close(ring->eventfd);
+	free(ring->peer);
+
+	context->rings[index] = context->rings[--context->ring_count];
+}
+
+////////////////////////////////////////////////////////////
+// ܣǼǹڴͨ
+// 룺D-BusģԶƣǷΪͷӳַӳС
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_shm_add(DBUS_CONTEXT* context, const char* peer, int producer, void* base, size_t size, int eventfd)
+{
+	// 1.ע߱仯Զ˳ʱرͨ
+	if (dbus_context_match_owners(context)) {
+		return -1;
+	}
+
+	// 2.ͬһԶֻµͨ
+	int i;
+	for (i = 0; i < context->ring_count; i++) {
+		if (context->rings[i].producer == producer && !strcmp(context->rings[i].peer, peer)) {
+			dbus_shm_close(context, i);
+			break;
+		}
+	}
+
+	// 3.Ǽ
+	DBUS_SHM_RING* rings = realloc(context->rings, (context->ring_count + 1) * sizeof(DBUS_SHM_RING));
+	if (!rings) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
+	context->rings = rings;
+
+	DBUS_SHM_RING* ring = &context->rings[context->ring_count];
+	ring->peer = strdup(peer);
+	if (!ring->peer) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
+	ring->producer = producer;
+	ring->header = base;
+	ring->data = (char*)base + sizeof(DBUS_SHM_HEADER);
+	ring->size = size;
+	ring->eventfd = eventfd;
+	context->ring_count++;
+
+	// 4.շ
+	if (!producer) {
+		dbus_context_watch_fd(context, eventfd, DBUS_EVENT_READABLE);
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣշͨ󣺴ڴ뻽ͨݸͷ
+// 룺D-BusģD-BusϢ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_shm_accept(DBUS_CONTEXT* context, DBusMessage* message)
+{
+	const char* sender = dbus_message_get_sender(message);
+	const char* reason = NULL;
+	int memfd = -1;
+	int efd = -1;
+	void* base = MAP_FAILED;
+
+	// 1.Ƿִ֧
+	if (!sender || !dbus_connection_can_send_type(context->connection, DBUS_TYPE_UNIX_FD)) {
+		reason = "File descriptor passing not supported";
+	}
+	else if (context->ring_count >= DBUS_SHM_MAX) {
+		reason = "Too many shared memory channels";
+	}
+
+	// 2.ڴ棨ӡСֹԶ˽ضϣ뻽
+	if (!reason) {
+		memfd = memfd_create("dbus-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+		efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (memfd < 0 || efd < 0 || ftruncate(memfd, DBUS_SHM_SIZE)
+			|| fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+			reason = strerror(errno);
+		}
+	}
+	if (!reason) {
+		base = mmap(NULL, DBUS_SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+		if (base == MAP_FAILED) {
+			reason = strerror(errno);
+		}
+	}
+
+	// 3.ʼͨͷǼ
+	if (!reason) {
+		DBUS_SHM_HEADER* header = base;
+		memset(header, 0, sizeof(DBUS_SHM_HEADER));
+		header->magic = DBUS_SHM_MAGIC;
+		header->capacity = DBUS_SHM_CAPACITY(DBUS_SHM_SIZE);
+		if (dbus_shm_add(context, sender, 0, base, DBUS_SHM_SIZE, efd)) {
+			reason = "Out of memory";
+		}
+	}
+
+	// 4.ɹʱڴ뻽ʧʱشɷͷ˻D-Bus
+	DBusMessage* reply;
+	if (reason) {
+		if (base != MAP_FAILED) {
+			munmap(base, DBUS_SHM_SIZE);
+		}
+		if (efd >= 0) {
+			close(efd);
+		}
+		reply = dbus_message_new_error(message, DBUS_ERROR_NOT_SUPPORTED, reason);
+	}
+	else {
+		reply = dbus_message_new_method_return(message);
+		if (reply && !dbus_message_append_args(reply, DBUS_TYPE_UNIX_FD, &memfd, DBUS_TYPE_UNIX_FD, &efd, DBUS_TYPE_INVALID)) {
+			dbus_message_unref(reply);
+			reply = NULL;
+		}
+	}
+	if (memfd >= 0) {
+		close(memfd);
+	}
+	if (!reply) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
+	if (!dbus_connection_send(context->connection, reply, NULL)) {
+		printf("Error: Out of Memory\n");
+	}
+	dbus_message_unref(reply);
+
+	if (reason) {
+		printf("Shared Memory Error: %s\n", reason);
+		return -1;
+	}
+	printf("[%d] Shared Memory Channel Opened: %s\n", getpid(), sender);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͷշڴͨ˺ýշźͨ
+// 룺D-Busģշݽṹ
+// 
+// أ0-ɹ -1-ʧܣźżͨD-Busͣ
+////////////////////////////////////////////////////////////
+int dbus_context_open_shm(DBUS_CONTEXT* context, DBUS_APPLICATION receiver)
+{
+	// 1.Ƿִ֧
+	if (!context->connection || !dbus_connection_can_send_type(context->connection, DBUS_TYPE_UNIX_FD)) {
+		printf("Shared Memory Error: File descriptor passing not supported\n");
+		return -1;
+	}
+
+	// 2.շͨ
+	DBusMessage* message = dbus_message_new_method_call(receiver.bus_name, receiver.object_path, receiver.interface_name, DBUS_MEMBER_SHM);
+	if (!message) {
+		printf("Error: Method Call Message NULL\n");
+		return -1;
+	}
+
+	DBusError error;
+	dbus_error_init(&error);
+	DBusMessage* reply = dbus_connection_send_with_reply_and_block(context->connection, message, DBUS_TIMEOUT_USE_DEFAULT, &error);
+	dbus_message_unref(message);
+	if (!reply) {
+		printf("Shared Memory Error: %s\n", error.message);
+		dbus_error_free(&error);
+		return -1;
+	}
+
+	// 3.ȡڴ뻽
+	int memfd;
+	int efd;
+	if (!dbus_message_get_args(reply, &error, DBUS_TYPE_UNIX_FD, &memfd, DBUS_TYPE_UNIX_FD, &efd, DBUS_TYPE_INVALID)) {
+		printf("Shared Memory Error: %s\n", error.message);
+		dbus_error_free(&error);
+		dbus_message_unref(reply);
+		return -1;
+	}
+	dbus_message_unref(reply);
+
+	// 4.ӳ䲢Уͨͷ
+	struct stat st;
+	void* base = MAP_FAILED;
+	if (!fstat(memfd, &st) && st.st_size > (off_t)sizeof(DBUS_SHM_HEADER)) {
+		base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	}
+	close(memfd);
+	if (base == MAP_FAILED) {
+		printf("Shared Memory Error: %s\n", strerror(errno));
+		close(efd);
+		return -1;
+	}
+
+	DBUS_SHM_HEADER* header = base;
+	if (header->magic != DBUS_SHM_MAGIC || header->capacity > st.st_size - sizeof(DBUS_SHM_HEADER) || header->capacity % 8) {
+		printf("Shared Memory Error: Invalid Channel\n");
+		munmap(base, st.st_size);
+		close(efd);
+		return -1;
+	}
+
+	// 5.Ǽ
+	if (dbus_shm_add(context, receiver.bus_name, 1, base, st.st_size, efd)) {
+		munmap(base, st.st_size);
+		close(efd);
+		return -1;
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͨڴͨź
+// 룺D-BusģշݽṹϢݽṹ
+// 
+// أ0-ѷ 1-޿ͨɵ÷D-Bus DBUS_SEND_RETRY-ͨԺԣ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_shm_send(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, DBUS_DATA data)
+{
+	// 1.ҷýշͨ
+	DBUS_SHM_RING* ring = NULL;
+	int i;
+	for (i = 0; i < context->ring_count; i++) {
+		if (context->rings[i].producer && receiver.bus_name && !strcmp(context->rings[i].peer, receiver.bus_name)) {
+			ring = &context->rings[i];
+			break;
+		}
+	}
+	if (!ring) {
+		return 1;
+	}
+	DBUS_SHM_HEADER* header = ring->header;
+	if (__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE)) {
+		dbus_shm_close(context, i);
+		return 1;
+	}
+
+	// 2.л
+	const void* payload;
+	unsigned int length;
+	int value_int;
+
+	switch (data.type) {
+	case DBUS_DATA_TYPE_STRING:
+		payload = data.value;
+		length = strlen(data.value) + 1;
+		break;
+	case DBUS_DATA_TYPE_INT32:
+		value_int = atoi(data.value);
+		payload = &value_int;
+		length = sizeof(value_int);
+		break;
+	default:
+		printf("Error: Unknown Argument Type\n");
+		return -1;
+	}
+
+	// 3.ռ䣨βŲʱд¼صʼ
+	//   ͨD-Busɽշֱȡ˻D-Bus󷢵Ϣȵ
+	unsigned long long capacity = header->capacity;
+	unsigned long long need = DBUS_SHM_ALIGN(sizeof(DBUS_SHM_RECORD) + (unsigned long long)length);
+	unsigned long long tail = header->tail;
+	unsigned long long head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+
+	if (need > capacity / 2) {
+		// ͨŲµϢշȡм¼ùر֮ͨȫD-Bus
+		if (head != tail) {
+			return DBUS_SEND_RETRY;
+		}
+		printf("[%d] Shared Memory Channel Closed: %s (Message Too Large)\n", getpid(), ring->peer);
+		dbus_shm_close(context, i);
+		return 1;
+	}
+
+	unsigned long long offset = tail % capacity;
+	unsigned long long contiguous = capacity - offset;
+	unsigned long long total = need + (contiguous < need ? contiguous : 0);
+	if (tail + total - head > capacity) {
+		return DBUS_SEND_RETRY;
+	}
+
+	if (contiguous < need) {
+		DBUS_SHM_RECORD* pad = (DBUS_SHM_RECORD*)(ring->data + offset);
+		pad->length = contiguous - sizeof(DBUS_SHM_RECORD);
+		pad->type = DBUS_SHM_RECORD_PAD;
+		tail += contiguous;
+		offset = 0;
+	}
+
+	// 4.д¼
+	DBUS_SHM_RECORD* record = (DBUS_SHM_RECORD*)(ring->data + offset);
+	record->length = length;
+	record->type = data.type + 1;
+	memcpy(record + 1, payload, length);
+	__atomic_store_n(&header->tail, tail + need, __ATOMIC_RELEASE);
+
+	// 5.ߵȴʱ
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&header->waiting, __ATOMIC_RELAXED) && __atomic_exchange_n(&header->waiting, 0, __ATOMIC_ACQ_REL)) {
+		unsigned long long one = 1;
+		if (write(ring->eventfd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+			printf("Shared Memory Error: %s\n", strerror(errno));
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣշͨǷδļ¼ȫΪʱǼǵȴ
+// 룺D-Bus
+// 
+// أ1-δ¼ 0-ȫΪ
+////////////////////////////////////////////////////////////
+int dbus_shm_pending(DBUS_CONTEXT* context)
+{
+	int i;
+	for (i = 0; i < context->ring_count; i++) {
+		DBUS_SHM_RING* ring = &context->rings[i];
+		if (ring->producer) {
+			continue;
+		}
+
+		// ȵǼǵȴټ飬֤߷һܿȴ־
+		__atomic_store_n(&ring->header->waiting, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&ring->header->tail, __ATOMIC_SEQ_CST) != ring->header->head) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡһͨеļ¼
+// 룺D-Busģͨദļ¼
+// 
+// أļ¼-1-ͨ
+////////////////////////////////////////////////////////////
+static int dbus_shm_read(DBUS_CONTEXT* context, DBUS_SHM_RING* ring, int budget)
+{
+	// ͷԶ˿дӳС㣨Զ˸Ϊ0ʱȡģ
+	DBUS_SHM_HEADER* header = ring->header;
+	unsigned long long capacity = DBUS_SHM_CAPACITY(ring->size);
+	unsigned long long head = header->head;
+	unsigned long long tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+	int count = 0;
+
+	while (head != tail && count < budget) {
+		// 1.У¼Զ˿дݣ
+		unsigned long long offset = head % capacity;
+		if (tail - head > capacity || offset + sizeof(DBUS_SHM_RECORD) > capacity) {
+			return -1;
+		}
+		DBUS_SHM_RECORD record = *(DBUS_SHM_RECORD*)(ring->data + offset);
+		unsigned long long size = DBUS_SHM_ALIGN(sizeof(DBUS_SHM_RECORD) + (unsigned long long)record.length);
+		if (offset + size > capacity || head + size > tail) {
+			return -1;
+		}
+		if (record.type == DBUS_SHM_RECORD_PAD) {
+			head += size;
+			continue;
+		}
+
+		// 2.ݺٴԶ˲޸
+		if (record.length + 1 > context->scratch_size) {
+			char* scratch = realloc(context->scratch, record.length + 1);
+			if (!scratch) {
+				printf("Error: Out of Memory\n");
+				break;
+			}
+			context->scratch = scratch;
+			context->scratch_size = record.length + 1;
+		}
+		memcpy(context->scratch, ring->data + offset + sizeof(DBUS_SHM_RECORD), record.length);
+		context->scratch[record.length] = '\0';
+		head += size;
+		__atomic_store_n(&header->head, head, __ATOMIC_RELEASE);
+
+		// 3.ԭΪϢݽṹ
+		DBUS_DATA data;
+		char buffer[16];
+		int value_int;
+
+		switch (record.type - 1) {
+		case DBUS_DATA_TYPE_STRING:
+			data.type = DBUS_DATA_TYPE_STRING;
+			data.value = context->scratch;
+			break;
+		case DBUS_DATA_TYPE_INT32:
+			if (record.length != sizeof(value_int)) {
+				return -1;
+			}
+			memcpy(&value_int, context->scratch, sizeof(value_int));
+			snprintf(buffer, sizeof(buffer), "%d", value_int);
+			data.type = DBUS_DATA_TYPE_INT32;
+			data.value = buffer;
+			break;
+		default:
+			return -1;
+		}
+
+		dbus_handle_signal(context, data);
+		count++;
+	}
+
+	__atomic_store_n(&header->head, head, __ATOMIC_RELEASE);
+	return count;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͨתյļ¼
+// 룺D-Busģദļ¼
+// 
+// أļ¼
+////////////////////////////////////////////////////////////
+int dbus_shm_dispatch(DBUS_CONTEXT* context, int budget)
+{
+	int count = 0;
+	int visited;
+
+	// ÿͨÿദquantumⵥͷռδ
+	int quantum = context->ring_count ? budget / context->ring_count : budget;
+	if (quantum < 1) {
+		quantum = 1;
+	}
+
+	for (visited = 0; visited < context->ring_count && count < budget; visited++) {
+		if (context->ring_next >= context->ring_count) {
+			context->ring_next = 0;
+		}
+		int index = context->ring_next++;
+		if (context->rings[index].producer) {
+			continue;
+		}
+
+		int ret = dbus_shm_read(context, &context->rings[index], quantum < budget - count ? quantum : budget - count);
+		if (ret < 0) {
+			printf("Shared Memory Error: Corrupt Channel From %s\n", context->rings[index].peer);
+			dbus_shm_close(context, index);
+			continue;
+		}
+		count += ret;
+	}
+
+	return count;
+}
+
+////////////////////////////////////////////////////////////
+// ܣĿɶ¼
+// 룺D-Busģ
+// 
+// أ0-Ѵ -1-ͨĻ
+////////////////////////////////////////////////////////////
+int dbus_shm_handle_wakeup(DBUS_CONTEXT* context, int fd)
+{
+	int i;
+	for (i = 0; i < context->ring_count; i++) {
+		if (!context->rings[i].producer && context->rings[i].eventfd == fd) {
+			unsigned long long value;
+			if (read(fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+				printf("Shared Memory Error: %s\n", strerror(errno));
+			}
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ߱仯ʱرصͨ
+// 룺D-BusģNameOwnerChangedź
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_shm_name_changed(DBUS_CONTEXT* context, DBusMessage* message)
+{
+	const char* name;
+	const char* old_owner;
+	const char* new_owner;
+
+	if (!context->ring_count || !dbus_message_get_args(message, NULL, DBUS_TYPE_STRING, &name,
+			DBUS_TYPE_STRING, &old_owner, DBUS_TYPE_STRING, &new_owner, DBUS_TYPE_INVALID)) {
+		return;
+	}
+
+	// ͷ˳շƻߣʵ
+	int i = 0;
+	while (i < context->ring_count) {
+		DBUS_SHM_RING* ring = &context->rings[i];
+		if (!strcmp(ring->peer, name) && (ring->producer || !*new_owner)) {
+			// ͷ˳ͨʣļ¼ٹر
+			if (!ring->producer) {
+				dbus_shm_read(context, ring, DBUS_SHM_CAPACITY(ring->size));
+			}
+			printf("[%d] Shared Memory Channel Closed: %s\n", getpid(), name);
+			dbus_shm_close(context, i);
+			continue;
+		}
+		i++;
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣ֪ͨȫͷͨѹرգ֮Ϣ˻D-Busͨеļ¼Կɴ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_shm_stop(DBUS_CONTEXT* context)
+{
+	int i;
+	for (i = 0; i < context->ring_count; i++) {
+		if (!context->rings[i].producer) {
+			__atomic_store_n(&context->rings[i].header->closed, 1, __ATOMIC_RELEASE);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣرȫڴͨ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_shm_free(DBUS_CONTEXT* context)
+{
+	while (context->ring_count) {
+		dbus_shm_close(context, context->ring_count - 1);
+	}
+	free(context->rings);
+	free(context->scratch);
+	context->rings = NULL;
+	context->scratch = NULL;
+	context->scratch_size = 0;
+}
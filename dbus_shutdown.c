@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+#define DBUS_SHUTDOWN_SIGNAL_MAX	4
+
+
+static DBUS_CONTEXT* volatile shutdown_context = NULL;
+static int shutdown_signals[DBUS_SHUTDOWN_SIGNAL_MAX];
+static struct sigaction shutdown_previous[DBUS_SHUTDOWN_SIGNAL_MAX];
+static int shutdown_signal_count = 0;
+
+
+////////////////////////////////////////////////////////////
+// ܣźŴֻ첽źŰȫĲ
+// 룺ź
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_shutdown_signal_handler(int signum)
+{
+	DBUS_CONTEXT* context = shutdown_context;
+	(void)signum;
+	if (context) {
+		dbus_context_shutdown(context);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣ˳첽źŰȫźŴ߳еã
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_shutdown(DBUS_CONTEXT* context)
+{
+	int saved = errno;
+	unsigned long long one = 1;
+
+	context->shutdown_requested = 1;
+	if (context->shutdown_fd >= 0 && write(context->shutdown_fd, &one, sizeof(one)) < 0) {
+		// ʱ¼ѭһᱻѣ
+	}
+	errno = saved;
+}
+
+////////////////////////////////////////////////////////////
+// ܣյָźʱ˳ͬһʱֻһĴźţ
+// 룺D-Busģź
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_context_shutdown_on_signal(DBUS_CONTEXT* context, int signum)
+{
+	if (shutdown_context && shutdown_context != context) {
+		printf("Error: Signals Already Handled By Another Context\n");
+		return -1;
+	}
+
+	// 1.ѾǼǹź
+	int i;
+	for (i = 0; i < shutdown_signal_count; i++) {
+		if (shutdown_signals[i] == signum) {
+			return 0;
+		}
+	}
+	if (shutdown_signal_count >= DBUS_SHUTDOWN_SIGNAL_MAX) {
+		printf("Error: Too Many Signals\n");
+		return -1;
+	}
+
+	// 2.װźŴԭʽرʱָ
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = dbus_shutdown_signal_handler;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+
+	shutdown_context = context;
+	if (sigaction(signum, &action, &shutdown_previous[shutdown_signal_count])) {
+		printf("Error: Install Signal Handler Failed: %s\n", strerror(errno));
+		if (!shutdown_signal_count) {
+			shutdown_context = NULL;
+		}
+		return -1;
+	}
+	shutdown_signals[shutdown_signal_count++] = signum;
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ˳ʱȴϢʱ
+// 룺D-Busģ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_set_drain_timeout(DBUS_CONTEXT* context, int timeout)
+{
+	context->drain_timeout = timeout >= 0 ? timeout : DBUS_DRAIN_TIMEOUT;
+}
+
+////////////////////////////////////////////////////////////
+// ܣѯ˳Ƿɣⲿ¼ѭݴ˳
+// 룺D-Bus
+// 
+// أ1- 0-δ
+////////////////////////////////////////////////////////////
+int dbus_context_is_drained(DBUS_CONTEXT* context)
+{
+	return context->drained;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ˳ǼǼ
+// 룺D-Bus
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_shutdown_init(DBUS_CONTEXT* context)
+{
+	context->drain_timeout = DBUS_DRAIN_TIMEOUT;
+	context->shutdown_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (context->shutdown_fd < 0) {
+		printf("Error: Create Eventfd Failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	dbus_context_watch_fd(context, context->shutdown_fd, DBUS_WATCH_READABLE);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣʼ˳ٽϢͷƣյϢ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_shutdown_begin(DBUS_CONTEXT* context)
+{
+	int i;
+
+	if (context->stopping) {
+		return;
+	}
+	printf("[%d] Shutting Down\n", getpid());
+
+	// 1.δŷ
+	dbus_batch_flush(context);
+
+	// 2.ͷƣʵӹܣ߰˳Ͷݣ
+	//   ͷǰƵϢѽ뱾ն
+	if (context->connection) {
+		if (context->self.bus_name) {
+			DBusError error;
+			dbus_error_init(&error);
+			dbus_bus_release_name(context->connection, context->self.bus_name, &error);
+			if (dbus_error_is_set(&error)) {
+				printf("Release Name Error: %s\n", error.message);
+				dbus_error_free(&error);
+			}
+		}
+		for (i = 0; i < context->rule_count; i++) {
+			dbus_bus_remove_match(context->connection, context->rules[i], NULL);
+		}
+
+		// 3.ѵϢУ֮󵽴ĺֱӷش
+		while (dbus_connection_get_dispatch_status(context->connection) == DBUS_DISPATCH_DATA_REMAINS) {
+			dbus_connection_dispatch(context->connection);
+		}
+	}
+	context->stopping = 1;
+
+	// 4.֪ͨڴͨķͷ˻D-Busͨеļ¼
+	dbus_shm_stop(context);
+
+	// 5.Ǽȴʱ
+	context->drain_deadline = dbus_monotonic_ms() + context->drain_timeout;
+	dbus_context_update_timeout(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣ˳Ŀɶ¼
+// 룺D-Busģ
+// 
+// أ0-Ѵ -1-˳
+////////////////////////////////////////////////////////////
+int dbus_shutdown_handle_wakeup(DBUS_CONTEXT* context, int fd)
+{
+	if (fd != context->shutdown_fd) {
+		return -1;
+	}
+
+	unsigned long long value;
+	if (read(fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+		printf("Error: %s\n", strerror(errno));
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣƽ˳̣ÿηַãʱд֪ͨ¼ѭ˳
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_shutdown_check(DBUS_CONTEXT* context)
+{
+	// 1.յ˳
+	if (!context->shutdown_requested || context->drained) {
+		return;
+	}
+	if (!context->stopping) {
+		dbus_shutdown_begin(context);
+	}
+
+	// 2.дϢδصĺδʱʱ
+	int pending = context->queued || context->calls || dbus_shm_pending(context);
+	if (pending && context->connection && dbus_monotonic_ms() < context->drain_deadline) {
+		return;
+	}
+
+	// 3.ʱʣຯ÷ش󣬱÷ȵʱ
+	if (pending) {
+		printf("[%d] Drain Timeout, %d Pending, %d Calls Outstanding\n", getpid(), context->queued, context->calls);
+		dbus_limit_reject_pending(context, DBUS_ERROR_NO_SERVER, "Service is shutting down");
+	}
+
+	// 4.д˳
+	if (context->connection) {
+		dbus_connection_flush(context->connection);
+	}
+	context->drained = 1;
+	context->drain_deadline = 0;
+	context->quit = 1;
+	printf("[%d] Drained\n", getpid());
+}
+
+////////////////////////////////////////////////////////////
+// ܣָźŴʽر˳
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_shutdown_free(DBUS_CONTEXT* context)
+{
+	int i;
+
+	if (shutdown_context == context) {
+		for (i = 0; i < shutdown_signal_count; i++) {
+			sigaction(shutdown_signals[i], &shutdown_previous[i], NULL);
+		}
+		shutdown_signal_count = 0;
+		shutdown_context = NULL;
+	}
+
+	if (context->shutdown_fd >= 0) {
+		dbus_context_watch_fd(context, context->shutdown_fd, 0);
+		close(context->shutdown_fd);
+		context->shutdown_fd = -1;
+	}
+}
@@ -0,0 +1,811 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dbus/dbus.h>
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+#define DBUS_STREAM_STATE_OPEN		0		// 
+#define DBUS_STREAM_STATE_CLOSING	1		// رգȴʣƬȷ
+#define DBUS_STREAM_STATE_FAILED	2		// ʧܣȴʣ÷غص
+
+
+////////////////////////////////////////////////////////////
+// ܣѯ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+const char* dbus_stream_get_name(DBUS_STREAM* stream)
+{
+	return stream->name;
+}
+
+////////////////////////////////////////////////////////////
+// ܣѯܳ
+// 룺
+// 
+// أֽ
+////////////////////////////////////////////////////////////
+unsigned long long dbus_stream_get_size(DBUS_STREAM* stream)
+{
+	return stream->size;
+}
+
+////////////////////////////////////////////////////////////
+// ܣѯд루ͷѽգշֽ
+// 룺
+// 
+// أֽ
+////////////////////////////////////////////////////////////
+unsigned long long dbus_stream_get_offset(DBUS_STREAM* stream)
+{
+	return stream->offset;
+}
+
+////////////////////////////////////////////////////////////
+// ܣýĻصԶ˴ʱɻص鵽ļ
+// 룺D-BusģջصNULL-ܾȫû
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_set_stream_function(DBUS_CONTEXT* context, DBUS_STREAM_ACCEPT_FUNCTION function, void* user_data)
+{
+	context->stream_function = function;
+	context->stream_data = user_data;
+}
+
+////////////////////////////////////////////////////////////
+// ܣýĿʱޣʱԶ˲ٷȴϿʱͷ
+// 룺D-Busģ루0ʱʹĬֵ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_context_set_stream_timeout(DBUS_CONTEXT* context, int timeout)
+{
+	context->stream_timeout = timeout > 0 ? timeout : DBUS_STREAM_IDLE_TIMEOUT;
+	dbus_context_update_timeout(context);
+}
+
+////////////////////////////////////////////////////////////
+// ܣǼ
+// 룺D-Busģ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_stream_add(DBUS_CONTEXT* context, DBUS_STREAM* stream)
+{
+	DBUS_STREAM** streams = realloc(context->streams, (context->stream_count + 1) * sizeof(DBUS_STREAM*));
+	if (!streams) {
+		printf("Error: Out of Memory\n");
+		return -1;
+	}
+	context->streams = streams;
+	context->streams[context->stream_count++] = stream;
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣƳͷ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_remove(DBUS_STREAM* stream)
+{
+	DBUS_CONTEXT* context = stream->context;
+
+	int i;
+	for (i = 0; i < context->stream_count; i++) {
+		if (context->streams[i] == stream) {
+			context->streams[i] = context->streams[--context->stream_count];
+			break;
+		}
+	}
+
+	free(stream->peer);
+	free(stream->path);
+	free(stream->interface);
+	free(stream->name);
+	free(stream->chunk);
+	free(stream);
+}
+
+////////////////////////////////////////////////////////////
+// ܣصսͷţصʹã
+// 룺¼
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_finish(DBUS_STREAM* stream, int event)
+{
+	if (stream->function) {
+		stream->function(stream, event, stream->user_data);
+	}
+	dbus_stream_remove(stream);
+}
+
+////////////////////////////////////////////////////////////
+// ܣշϢ
+// 룺Ա
+// 
+// أD-BusϢNULL-ʧ
+////////////////////////////////////////////////////////////
+static DBusMessage* dbus_stream_message(DBUS_STREAM* stream, const char* member)
+{
+	DBusMessage* message = dbus_message_new_method_call(stream->peer, stream->path, stream->interface, member);
+	if (!message) {
+		printf("Error: Method Call Message NULL\n");
+	}
+	return message;
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢҪȷʱ;ã۳ɰܶͷϢ
+// 룺D-BusϢǷҪȷ
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+static void dbus_stream_acked(int status, DBUS_DATA data, void* user_data);
+
+static int dbus_stream_transmit(DBUS_STREAM* stream, DBusMessage* message, int acked)
+{
+	DBUS_REPLY_CLOSURE* closure = NULL;
+
+	if (acked) {
+		closure = malloc(sizeof(DBUS_REPLY_CLOSURE));
+		if (!closure) {
+			printf("Error: Out of Memory\n");
+			dbus_message_unref(message);
+			return -1;
+		}
+		closure->context = stream->context;
+		closure->function = dbus_stream_acked;
+		closure->user_data = stream;
+	}
+	else {
+		dbus_message_set_no_reply(message, TRUE);
+	}
+
+	int ret = dbus_context_transmit(stream->context, message, closure);
+	dbus_message_unref(message);
+	if (ret) {
+		free(closure);
+		return -1;
+	}
+	if (acked) {
+		stream->inflight++;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣʧܣ֪ͨշҪȷϣʣȫغص
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_fail(DBUS_STREAM* stream)
+{
+	if (stream->state == DBUS_STREAM_STATE_FAILED) {
+		return;
+	}
+	stream->state = DBUS_STREAM_STATE_FAILED;
+
+	DBusMessage* message = dbus_stream_message(stream, DBUS_MEMBER_STREAM_CLOSE);
+	dbus_bool_t complete = FALSE;
+	if (message) {
+		if (dbus_message_append_args(message, DBUS_TYPE_UINT32, &stream->id, DBUS_TYPE_UINT64, &stream->offset,
+				DBUS_TYPE_BOOLEAN, &complete, DBUS_TYPE_INVALID)) {
+			dbus_stream_transmit(stream, message, 0);
+		}
+		else {
+			dbus_message_unref(message);
+		}
+	}
+}
+
+static int dbus_stream_advance(DBUS_STREAM* stream);
+
+////////////////////////////////////////////////////////////
+// ܣ÷ӿֹû;ʱصFAILEDͷ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_abort(DBUS_STREAM* stream)
+{
+	dbus_stream_fail(stream);
+	dbus_stream_advance(stream);
+}
+
+////////////////////////////////////////////////////////////
+// ܣǰƬʱ
+// 룺
+// 
+// أ1-ѷ 0- -1-ʧ
+////////////////////////////////////////////////////////////
+static int dbus_stream_send_chunk(DBUS_STREAM* stream)
+{
+	if (stream->inflight >= DBUS_STREAM_WINDOW) {
+		return 0;
+	}
+
+	// ƬššݣշУ˳
+	DBusMessage* message = dbus_stream_message(stream, DBUS_MEMBER_STREAM_CHUNK);
+	const char* data = stream->chunk;
+	if (!message) {
+		return -1;
+	}
+	if (!dbus_message_append_args(message, DBUS_TYPE_UINT32, &stream->id, DBUS_TYPE_UINT32, &stream->seq,
+			DBUS_TYPE_ARRAY, DBUS_TYPE_BYTE, &data, (int)stream->chunk_used, DBUS_TYPE_INVALID)) {
+		printf("Message Append Error: Out of Memory\n");
+		dbus_message_unref(message);
+		return -1;
+	}
+	if (dbus_stream_transmit(stream, message, 1)) {
+		return -1;
+	}
+
+	stream->seq++;
+	stream->chunk_used = 0;
+	return 1;
+}
+
+////////////////////////////////////////////////////////////
+// ܣƽͣرʱһƬرȫȷϺص
+// 룺
+// 
+// أ0-Ч -1-ѻصͷ
+////////////////////////////////////////////////////////////
+static int dbus_stream_advance(DBUS_STREAM* stream)
+{
+	// 1.ʧܣȴʣ÷
+	if (stream->state == DBUS_STREAM_STATE_FAILED) {
+		if (!stream->inflight) {
+			dbus_stream_finish(stream, DBUS_STREAM_EVENT_FAILED);
+			return -1;
+		}
+		return 0;
+	}
+
+	// 2.ķƬ
+	if (stream->chunk_used == DBUS_STREAM_CHUNK && dbus_stream_send_chunk(stream) < 0) {
+		dbus_stream_fail(stream);
+		return dbus_stream_advance(stream);
+	}
+	if (stream->state != DBUS_STREAM_STATE_CLOSING) {
+		return 0;
+	}
+
+	// 3.رգʣر
+	if (stream->chunk_used && dbus_stream_send_chunk(stream) < 0) {
+		dbus_stream_fail(stream);
+		return dbus_stream_advance(stream);
+	}
+	if (!stream->chunk_used && !stream->close_sent && stream->inflight < DBUS_STREAM_WINDOW) {
+		DBusMessage* message = dbus_stream_message(stream, DBUS_MEMBER_STREAM_CLOSE);
+		dbus_bool_t complete = TRUE;
+		if (!message) {
+			dbus_stream_fail(stream);
+			return dbus_stream_advance(stream);
+		}
+		if (!dbus_message_append_args(message, DBUS_TYPE_UINT32, &stream->id, DBUS_TYPE_UINT64, &stream->offset,
+				DBUS_TYPE_BOOLEAN, &complete, DBUS_TYPE_INVALID)) {
+			printf("Message Append Error: Out of Memory\n");
+			dbus_message_unref(message);
+			dbus_stream_fail(stream);
+			return dbus_stream_advance(stream);
+		}
+		if (dbus_stream_transmit(stream, message, 1)) {
+			dbus_stream_fail(stream);
+			return dbus_stream_advance(stream);
+		}
+		stream->close_sent = 1;
+	}
+
+	// 4.رҲȷ
+	if (stream->close_sent && !stream->inflight) {
+		dbus_stream_finish(stream, DBUS_STREAM_EVENT_DONE);
+		return -1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢȷϻصͷŴڣ֪ͨ÷д
+// 룺״̬ݣ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_acked(int status, DBUS_DATA data, void* user_data)
+{
+	DBUS_STREAM* stream = user_data;
+	(void)data;
+
+	stream->inflight--;
+	if (status) {
+		dbus_stream_fail(stream);
+	}
+	if (dbus_stream_advance(stream)) {
+		return;
+	}
+
+	if (stream->state == DBUS_STREAM_STATE_OPEN && stream->function) {
+		stream->function(stream, DBUS_STREAM_EVENT_WRITABLE, stream->user_data);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣ򿪷շпλʱصWRITABLE
+//       رպȫȷʱصDONEʧʱصFAILED֮ͷ
+// 룺D-BusģշݽṹҪbus_nameƣܳȣصû
+// 
+// أNULL-ʧ
+////////////////////////////////////////////////////////////
+DBUS_STREAM* dbus_stream_open(DBUS_CONTEXT* context, DBUS_APPLICATION receiver, const char* name, unsigned long long size,
+	DBUS_STREAM_FUNCTION function, void* user_data)
+{
+	if (!receiver.bus_name || !name) {
+		printf("Error: Stream Needs Receiver Name\n");
+		return NULL;
+	}
+
+	// 1.
+	DBUS_STREAM* stream = calloc(1, sizeof(DBUS_STREAM));
+	if (!stream) {
+		printf("Error: Out of Memory\n");
+		return NULL;
+	}
+	stream->context = context;
+	stream->peer = strdup(receiver.bus_name);
+	stream->path = strdup(receiver.object_path);
+	stream->interface = strdup(receiver.interface_name);
+	stream->name = strdup(name);
+	stream->chunk = malloc(DBUS_STREAM_CHUNK);
+	stream->id = ++context->stream_next_id;
+	stream->size = size;
+	stream->function = function;
+	stream->user_data = user_data;
+	if (!stream->peer || !stream->path || !stream->interface || !stream->name || !stream->chunk || dbus_stream_add(context, stream)) {
+		printf("Error: Out of Memory\n");
+		free(stream->peer);
+		free(stream->path);
+		free(stream->interface);
+		free(stream->name);
+		free(stream->chunk);
+		free(stream);
+		return NULL;
+	}
+
+	// 2.šơܳȣȴȷϼд룬Ϣ˳򵽴
+	DBusMessage* message = dbus_stream_message(stream, DBUS_MEMBER_STREAM_OPEN);
+	const char* stream_name = stream->name;
+	if (!message) {
+		dbus_stream_remove(stream);
+		return NULL;
+	}
+	if (!dbus_message_append_args(message, DBUS_TYPE_UINT32, &stream->id, DBUS_TYPE_STRING, &stream_name,
+			DBUS_TYPE_UINT64, &stream->size, DBUS_TYPE_INVALID)) {
+		printf("Message Append Error: Out of Memory\n");
+		dbus_message_unref(message);
+		dbus_stream_remove(stream);
+		return NULL;
+	}
+	if (dbus_stream_transmit(stream, message, 1)) {
+		dbus_stream_remove(stream);
+		return NULL;
+	}
+
+	return stream;
+}
+
+////////////////////////////////////////////////////////////
+// ܣдݣƵƬʱֻղݣ
+//       ȴWRITABLEصд
+// 룺ݣ
+// 
+// أյֽ0--1-ʧܣصFAILED֮󲻿ʹã
+////////////////////////////////////////////////////////////
+long dbus_stream_write(DBUS_STREAM* stream, const void* data, size_t length)
+{
+	const char* p = data;
+	size_t accepted = 0;
+
+	if (stream->state != DBUS_STREAM_STATE_OPEN) {
+		printf("Error: Stream Not Writable\n");
+		return -1;
+	}
+	if (length > stream->size - stream->offset) {
+		printf("Error: Stream Size Exceeded\n");
+		dbus_stream_abort(stream);
+		return -1;
+	}
+
+	while (accepted < length) {
+		// 1.Ƭʱʱֹͣ
+		if (stream->chunk_used == DBUS_STREAM_CHUNK) {
+			int ret = dbus_stream_send_chunk(stream);
+			if (ret < 0) {
+				dbus_stream_abort(stream);
+				return -1;
+			}
+			if (!ret) {
+				break;
+			}
+		}
+
+		// 2.ƵƬ
+		size_t copy = DBUS_STREAM_CHUNK - stream->chunk_used;
+		if (copy > length - accepted) {
+			copy = length - accepted;
+		}
+		memcpy(stream->chunk + stream->chunk_used, p + accepted, copy);
+		stream->chunk_used += copy;
+		stream->offset += copy;
+		accepted += copy;
+	}
+
+	// 3.պдʱ緢
+	if (stream->chunk_used == DBUS_STREAM_CHUNK && dbus_stream_send_chunk(stream) < 0) {
+		dbus_stream_abort(stream);
+		return -1;
+	}
+
+	return (long)accepted;
+}
+
+////////////////////////////////////////////////////////////
+// ܣرʣݣշȷصDONE
+// 룺
+// 
+// أ0-ɹ -1-ʧܣصFAILED֮󲻿ʹã
+////////////////////////////////////////////////////////////
+int dbus_stream_close(DBUS_STREAM* stream)
+{
+	if (stream->state != DBUS_STREAM_STATE_OPEN) {
+		printf("Error: Stream Not Writable\n");
+		return -1;
+	}
+	if (stream->offset != stream->size) {
+		printf("Error: Stream Closed At %llu Of %llu Bytes\n", (unsigned long long)stream->offset, (unsigned long long)stream->size);
+		dbus_stream_abort(stream);
+		return -1;
+	}
+
+	stream->state = DBUS_STREAM_STATE_CLOSING;
+	dbus_stream_advance(stream);
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣȷϽշյϢ
+// 룺D-BusģD-BusϢȷֵ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_reply(DBUS_CONTEXT* context, DBusMessage* message, dbus_int32_t value)
+{
+	if (dbus_message_get_no_reply(message)) {
+		return;
+	}
+
+	DBusMessage* reply = dbus_message_new_method_return(message);
+	if (!reply || !dbus_message_append_args(reply, DBUS_TYPE_INT32, &value, DBUS_TYPE_INVALID)
+		|| !dbus_connection_send(context->connection, reply, NULL)) {
+		printf("Error: Out of Memory\n");
+	}
+	if (reply) {
+		dbus_message_unref(reply);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣҶԶ˴򿪵
+// 룺D-Busģͷƣ
+// 
+// أNULL-
+////////////////////////////////////////////////////////////
+static DBUS_STREAM* dbus_stream_find(DBUS_CONTEXT* context, const char* sender, dbus_uint32_t id)
+{
+	int i;
+	for (i = 0; i < context->stream_count; i++) {
+		DBUS_STREAM* stream = context->streams[i];
+		if (stream->inbound && stream->id == id && !strcmp(stream->peer, sender)) {
+			return stream;
+		}
+	}
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////
+// ܣɽջصṩļ
+// 룺D-BusģD-BusϢͷ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_accept(DBUS_CONTEXT* context, DBusMessage* message, const char* sender)
+{
+	dbus_uint32_t id;
+	const char* name;
+	dbus_uint64_t size;
+
+	// 1.У
+	if (!dbus_message_get_args(message, NULL, DBUS_TYPE_UINT32, &id, DBUS_TYPE_STRING, &name, DBUS_TYPE_UINT64, &size, DBUS_TYPE_INVALID)) {
+		dbus_limit_reject(context, message, DBUS_ERROR_INVALID_ARGS, "Expected stream id, name and size");
+		return;
+	}
+	if (!context->stream_function) {
+		dbus_limit_reject(context, message, DBUS_ERROR_NOT_SUPPORTED, "Streams not accepted");
+		return;
+	}
+	if (dbus_stream_find(context, sender, id)) {
+		dbus_limit_reject(context, message, DBUS_ERROR_INVALID_ARGS, "Stream already open");
+		return;
+	}
+	int inbound = 0;
+	int i;
+	for (i = 0; i < context->stream_count; i++) {
+		inbound += context->streams[i]->inbound;
+	}
+	if (inbound >= DBUS_STREAM_MAX) {
+		dbus_limit_reject(context, message, DBUS_ERROR_LIMITS_EXCEEDED, "Too many streams");
+		return;
+	}
+
+	// 2.ע߱仯ͷ˳ʱ
+	if (dbus_context_match_owners(context)) {
+		dbus_limit_reject(context, message, DBUS_ERROR_NO_MEMORY, "Out of memory");
+		return;
+	}
+
+	// 3.ɻصλ
+	DBUS_STREAM* stream = calloc(1, sizeof(DBUS_STREAM));
+	if (!stream || !(stream->peer = strdup(sender)) || !(stream->name = strdup(name)) || dbus_stream_add(context, stream)) {
+		printf("Error: Out of Memory\n");
+		if (stream) {
+			free(stream->peer);
+			free(stream->name);
+			free(stream);
+		}
+		dbus_limit_reject(context, message, DBUS_ERROR_NO_MEMORY, "Out of memory");
+		return;
+	}
+	stream->context = context;
+	stream->inbound = 1;
+	stream->id = id;
+	stream->size = size;
+
+	DBUS_STREAM_SINK sink;
+	memset(&sink, 0, sizeof(sink));
+	sink.fd = -1;
+	if (context->stream_function(stream, &sink, context->stream_data)) {
+		dbus_stream_remove(stream);
+		dbus_limit_reject(context, message, DBUS_ERROR_ACCESS_DENIED, "Stream rejected");
+		return;
+	}
+	if ((sink.buffer && sink.capacity < size) || (!sink.buffer && sink.fd < 0)) {
+		printf("Error: Stream Sink Too Small\n");
+		stream->function = sink.function;
+		stream->user_data = sink.user_data;
+		dbus_stream_finish(stream, DBUS_STREAM_EVENT_FAILED);
+		dbus_limit_reject(context, message, DBUS_ERROR_LIMITS_EXCEEDED, "Stream too large");
+		return;
+	}
+	stream->sink = sink;
+	stream->function = sink.function;
+	stream->user_data = sink.user_data;
+	stream->active = dbus_monotonic_ms();
+	dbus_context_update_timeout(context);
+
+	dbus_stream_reply(context, message, 0);
+}
+
+////////////////////////////////////////////////////////////
+// ܣƬУ˳򣬰ƫд뻺ļ
+// 룺D-BusģD-BusϢͷ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_receive(DBUS_CONTEXT* context, DBusMessage* message, const char* sender)
+{
+	dbus_uint32_t id;
+	dbus_uint32_t seq;
+	const char* data;
+	int length;
+
+	// 1.У˳볤
+	if (!dbus_message_get_args(message, NULL, DBUS_TYPE_UINT32, &id, DBUS_TYPE_UINT32, &seq,
+			DBUS_TYPE_ARRAY, DBUS_TYPE_BYTE, &data, &length, DBUS_TYPE_INVALID)) {
+		dbus_limit_reject(context, message, DBUS_ERROR_INVALID_ARGS, "Expected stream id, sequence and data");
+		return;
+	}
+	DBUS_STREAM* stream = dbus_stream_find(context, sender, id);
+	if (!stream) {
+		dbus_limit_reject(context, message, DBUS_ERROR_UNKNOWN_OBJECT, "Unknown stream");
+		return;
+	}
+	if (seq != stream->seq || (unsigned long long)length > stream->size - stream->offset) {
+		printf("Error: Stream %s Chunk %u Out of Order or Too Long\n", stream->name, seq);
+		dbus_stream_finish(stream, DBUS_STREAM_EVENT_FAILED);
+		dbus_limit_reject(context, message, DBUS_ERROR_INVALID_ARGS, "Chunk out of order");
+		return;
+	}
+
+	// 2.д
+	if (stream->sink.buffer) {
+		memcpy(stream->sink.buffer + stream->offset, data, length);
+	}
+	else {
+		int written = 0;
+		while (written < length) {
+			ssize_t ret = pwrite(stream->sink.fd, data + written, length - written, stream->offset + written);
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret <= 0) {
+				printf("Error: Stream %s Write Failed: %s\n", stream->name, ret < 0 ? strerror(errno) : "no space");
+				dbus_stream_finish(stream, DBUS_STREAM_EVENT_FAILED);
+				dbus_limit_reject(context, message, DBUS_ERROR_IO_ERROR, "Write failed");
+				return;
+			}
+			written += ret;
+		}
+	}
+	stream->offset += length;
+	stream->seq++;
+	stream->active = dbus_monotonic_ms();
+
+	dbus_stream_reply(context, message, (dbus_int32_t)seq);
+}
+
+////////////////////////////////////////////////////////////
+// ܣر󣺳һʱصDONEصFAILED
+// 룺D-BusģD-BusϢͷ
+// 
+// أ
+////////////////////////////////////////////////////////////
+static void dbus_stream_end(DBUS_CONTEXT* context, DBusMessage* message, const char* sender)
+{
+	dbus_uint32_t id;
+	dbus_uint64_t total;
+	dbus_bool_t complete;
+
+	if (!dbus_message_get_args(message, NULL, DBUS_TYPE_UINT32, &id, DBUS_TYPE_UINT64, &total, DBUS_TYPE_BOOLEAN, &complete, DBUS_TYPE_INVALID)) {
+		dbus_limit_reject(context, message, DBUS_ERROR_INVALID_ARGS, "Expected stream id, size and status");
+		return;
+	}
+	DBUS_STREAM* stream = dbus_stream_find(context, sender, id);
+	if (!stream) {
+		dbus_limit_reject(context, message, DBUS_ERROR_UNKNOWN_OBJECT, "Unknown stream");
+		return;
+	}
+
+	if (!complete || total != stream->size || stream->offset != stream->size) {
+		dbus_stream_finish(stream, DBUS_STREAM_EVENT_FAILED);
+		dbus_limit_reject(context, message, DBUS_ERROR_FAILED, "Stream incomplete");
+		return;
+	}
+
+	dbus_stream_finish(stream, DBUS_STREAM_EVENT_DONE);
+	dbus_stream_reply(context, message, 0);
+}
+
+////////////////////////////////////////////////////////////
+// ܣϢ
+// 룺D-BusģD-BusϢ
+// 
+// أ0-Ѵ -1-Ϣ
+////////////////////////////////////////////////////////////
+int dbus_stream_handle(DBUS_CONTEXT* context, DBusMessage* message)
+{
+	const char* interface = context->self.interface_name;
+	const char* sender = dbus_message_get_sender(message);
+
+	if (dbus_message_is_method_call(message, interface, DBUS_MEMBER_STREAM_CHUNK)) {
+		dbus_stream_receive(context, message, sender ? sender : "");
+	}
+	else if (dbus_message_is_method_call(message, interface, DBUS_MEMBER_STREAM_OPEN)) {
+		dbus_stream_accept(context, message, sender ? sender : "");
+	}
+	else if (dbus_message_is_method_call(message, interface, DBUS_MEMBER_STREAM_CLOSE)) {
+		dbus_stream_end(context, message, sender ? sender : "");
+	}
+	else {
+		return -1;
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣͷ˳ʱ򿪵
+// 룺D-BusģNameOwnerChangedź
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_stream_name_changed(DBUS_CONTEXT* context, DBusMessage* message)
+{
+	const char* name;
+	const char* old_owner;
+	const char* new_owner;
+
+	if (!context->stream_count || !dbus_message_get_args(message, NULL, DBUS_TYPE_STRING, &name,
+			DBUS_TYPE_STRING, &old_owner, DBUS_TYPE_STRING, &new_owner, DBUS_TYPE_INVALID) || *new_owner) {
+		return;
+	}
+
+	int i = 0;
+	while (i < context->stream_count) {
+		DBUS_STREAM* stream = context->streams[i];
+		if (stream->inbound && !strcmp(stream->peer, name)) {
+			printf("[%d] Stream %s Abandoned By %s\n", getpid(), stream->name, name);
+			dbus_stream_finish(stream, DBUS_STREAM_EVENT_FAILED);
+			continue;
+		}
+		i++;
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣѯ絽ڵĽʱ
+// 룺D-Bus
+// 
+// أʱ䣨룩0-ûн
+////////////////////////////////////////////////////////////
+long long dbus_stream_deadline(DBUS_CONTEXT* context)
+{
+	long long deadline = 0;
+
+	int i;
+	for (i = 0; i < context->stream_count; i++) {
+		DBUS_STREAM* stream = context->streams[i];
+		if (stream->inbound && (!deadline || stream->active + context->stream_timeout < deadline)) {
+			deadline = stream->active + context->stream_timeout;
+		}
+	}
+	return deadline;
+}
+
+////////////////////////////////////////////////////////////
+// ܣгʱĽԶ֮ķƬش
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+int dbus_stream_expire(DBUS_CONTEXT* context)
+{
+	long long now = dbus_monotonic_ms();
+	int count = 0;
+
+	int i = 0;
+	while (i < context->stream_count) {
+		DBUS_STREAM* stream = context->streams[i];
+		if (stream->inbound && stream->active + context->stream_timeout <= now) {
+			printf("[%d] Stream %s From %s Idle, Abandoned\n", getpid(), stream->name, stream->peer);
+			dbus_stream_finish(stream, DBUS_STREAM_EVENT_FAILED);
+			count++;
+			continue;
+		}
+		i++;
+	}
+	return count;
+}
+
+////////////////////////////////////////////////////////////
+// ܣرʱͷȫѹرգȷϷأ
+// 룺D-Bus
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_stream_free(DBUS_CONTEXT* context)
+{
+	while (context->stream_count) {
+		dbus_stream_finish(context->streams[context->stream_count - 1], DBUS_STREAM_EVENT_FAILED);
+	}
+	free(context->streams);
+	context->streams = NULL;
+}
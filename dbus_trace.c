@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dbus/dbus.h>
+#ifdef DBUS_WITH_SDT
+#include <sys/sdt.h>
+#endif
+#include "dbus.h"
+#include "dbus_private.h"
+
+
+static int trace_enabled = 0;
+static FILE* trace_file = NULL;
+static int trace_events = 0;
+static unsigned long long trace_counter = 0;
+static dbus_int32_t trace_slot = -1;
+
+
+////////////////////////////////////////////////////////////
+// ܣȡʱʱ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+static unsigned long long dbus_trace_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////
+// ܣ̷Ϣĸ٣дļChrome trace JSONʽPerfettoأ
+// 룺ļ·NULL-ֻUSDT̽루SDT=1룩
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_trace_open(const char* path)
+{
+	dbus_trace_close();
+
+	if (!path) {
+#ifdef DBUS_WITH_SDT
+		trace_enabled = 1;
+		return 0;
+#else
+		printf("Error: USDT Probes Not Supported (build with SDT=1)\n");
+		return -1;
+#endif
+	}
+
+	trace_file = fopen(path, "w");
+	if (!trace_file) {
+		printf("Error: Open Trace File %s Failed\n", path);
+		return -1;
+	}
+
+	// 쳣˳ʱȱٽβ"]"ʽȻЧ
+	fprintf(trace_file, "[\n");
+	trace_events = 0;
+	trace_enabled = 1;
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣرոļֹͣ
+// 룺
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_trace_close(void)
+{
+	trace_enabled = 0;
+	if (!trace_file) {
+		return;
+	}
+
+	fprintf(trace_file, "\n]\n");
+	fclose(trace_file);
+	trace_file = NULL;
+}
+
+////////////////////////////////////////////////////////////
+// ܣʼһ͵Ϣδʱ٣
+// 룺ټ¼
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_trace_begin(DBUS_TRACE* trace)
+{
+	trace->id = 0;
+	trace->count = 0;
+
+	if (!trace_enabled) {
+		return;
+	}
+
+	// ٺţ̺šʱ䡢Żϣͬһڲظ
+	unsigned long long now = dbus_trace_now();
+	trace->id = ((unsigned long long)getpid() << 40) ^ (now & 0xFFFFFFFFFFULL) ^ (++trace_counter << 20);
+	if (!trace->id) {
+		trace->id = 1;
+	}
+	dbus_trace_mark(trace, "start");
+}
+
+////////////////////////////////////////////////////////////
+// ܣ¼һ׶ν
+// 룺ټ¼׶
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_trace_mark(DBUS_TRACE* trace, const char* name)
+{
+	if (!trace->id || trace->count >= DBUS_TRACE_STAGE_MAX) {
+		return;
+	}
+
+	DBUS_TRACE_STAGE* stage = &trace->stages[trace->count++];
+	snprintf(stage->name, sizeof(stage->name), "%s", name);
+	stage->pid = (unsigned int)getpid();
+	stage->stamp = dbus_trace_now();
+
+#ifdef DBUS_WITH_SDT
+	DTRACE_PROBE3(dbus, stage, trace->id, stage->name, stage->stamp);
+#endif
+}
+
+////////////////////////////////////////////////////////////
+// ܣټ¼Ϊĩβ׷ӵϢ
+// 룺D-BusϢټ¼
+// 
+// أ0-ɹ -1-ʧ
+////////////////////////////////////////////////////////////
+int dbus_trace_append(DBusMessage* message, DBUS_TRACE* trace)
+{
+	if (!trace->id) {
+		return 0;
+	}
+
+	DBusMessageIter iter;
+	DBusMessageIter struct_iter;
+	DBusMessageIter array_iter;
+	DBusMessageIter stage_iter;
+	dbus_uint64_t id = trace->id;
+	int i;
+
+	dbus_message_iter_init_append(message, &iter);
+	if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_STRUCT, NULL, &struct_iter)
+		|| !dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64, &id)
+		|| !dbus_message_iter_open_container(&struct_iter, DBUS_TYPE_ARRAY, "(sut)", &array_iter)) {
+		printf("Message Append Error: Out of Memory\n");
+		return -1;
+	}
+
+	for (i = 0; i < trace->count; i++) {
+		const char* name = trace->stages[i].name;
+		dbus_uint32_t pid = trace->stages[i].pid;
+		dbus_uint64_t stamp = trace->stages[i].stamp;
+
+		if (!dbus_message_iter_open_container(&array_iter, DBUS_TYPE_STRUCT, NULL, &stage_iter)
+			|| !dbus_message_iter_append_basic(&stage_iter, DBUS_TYPE_STRING, &name)
+			|| !dbus_message_iter_append_basic(&stage_iter, DBUS_TYPE_UINT32, &pid)
+			|| !dbus_message_iter_append_basic(&stage_iter, DBUS_TYPE_UINT64, &stamp)
+			|| !dbus_message_iter_close_container(&array_iter, &stage_iter)) {
+			printf("Message Append Error: Out of Memory\n");
+			return -1;
+		}
+	}
+
+	if (!dbus_message_iter_close_container(&struct_iter, &array_iter)
+		|| !dbus_message_iter_close_container(&iter, &struct_iter)) {
+		printf("Message Append Error: Out of Memory\n");
+		return -1;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣжϲǷΪٲ
+// 룺ָĵ
+// 
+// أ1- 0-
+////////////////////////////////////////////////////////////
+int dbus_trace_is_header(DBusMessageIter* iter)
+{
+	if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_STRUCT) {
+		return 0;
+	}
+
+	char* signature = dbus_message_iter_get_signature(iter);
+	if (!signature) {
+		return 0;
+	}
+	int ret = !strcmp(signature, DBUS_TRACE_SIGNATURE);
+	dbus_free(signature);
+	return ret;
+}
+
+////////////////////////////////////////////////////////////
+// ܣжϢǷЯٲֻȽǩĩβ
+// 룺D-BusϢ
+// 
+// أ1- 0-
+////////////////////////////////////////////////////////////
+static int dbus_trace_present(DBusMessage* message)
+{
+	const char* signature = dbus_message_get_signature(message);
+	size_t length = strlen(signature);
+	size_t suffix = strlen(DBUS_TRACE_SIGNATURE);
+
+	return length >= suffix && !strcmp(signature + length - suffix, DBUS_TRACE_SIGNATURE);
+}
+
+////////////////////////////////////////////////////////////
+// ܣ¼ЯٲϢշʱ䣨Ϣǰã
+// 룺D-BusϢ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_trace_arrive(DBusMessage* message)
+{
+	if (!dbus_trace_present(message)) {
+		return;
+	}
+	if (trace_slot < 0 && !dbus_message_allocate_data_slot(&trace_slot)) {
+		return;
+	}
+
+	unsigned long long* stamp = malloc(sizeof(*stamp));
+	if (!stamp) {
+		return;
+	}
+	*stamp = dbus_trace_now();
+	if (!dbus_message_set_data(message, trace_slot, stamp, free)) {
+		free(stamp);
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣȡϢЯĸټ¼׷ӵ׶Σbus
+// 룺D-BusϢ
+// ټ¼޸ٲʱidΪ0
+// أ0-ɹ -1-ϢδЯٲ
+////////////////////////////////////////////////////////////
+int dbus_trace_extract(DBusMessage* message, DBUS_TRACE* trace)
+{
+	trace->id = 0;
+	trace->count = 0;
+
+	if (!dbus_trace_present(message)) {
+		return -1;
+	}
+
+	// 1.λĩβ
+	DBusMessageIter iter;
+	if (!dbus_message_iter_init(message, &iter)) {
+		return -1;
+	}
+	while (dbus_message_iter_has_next(&iter)) {
+		dbus_message_iter_next(&iter);
+	}
+	if (!dbus_trace_is_header(&iter)) {
+		return -1;
+	}
+
+	// 2.ȡٺ׶
+	DBusMessageIter struct_iter;
+	DBusMessageIter array_iter;
+	DBusMessageIter stage_iter;
+	dbus_uint64_t id;
+
+	dbus_message_iter_recurse(&iter, &struct_iter);
+	dbus_message_iter_get_basic(&struct_iter, &id);
+	dbus_message_iter_next(&struct_iter);
+	dbus_message_iter_recurse(&struct_iter, &array_iter);
+
+	while (dbus_message_iter_get_arg_type(&array_iter) == DBUS_TYPE_STRUCT && trace->count < DBUS_TRACE_STAGE_MAX) {
+		DBUS_TRACE_STAGE* stage = &trace->stages[trace->count];
+		const char* name;
+		dbus_uint32_t pid;
+		dbus_uint64_t stamp;
+		char* p;
+
+		dbus_message_iter_recurse(&array_iter, &stage_iter);
+		dbus_message_iter_get_basic(&stage_iter, &name);
+		dbus_message_iter_next(&stage_iter);
+		dbus_message_iter_get_basic(&stage_iter, &pid);
+		dbus_message_iter_next(&stage_iter);
+		dbus_message_iter_get_basic(&stage_iter, &stamp);
+
+		// ԶԷֻ̣ɰȫдJSONַ
+		snprintf(stage->name, sizeof(stage->name), "%s", name);
+		for (p = stage->name; *p; p++) {
+			if (!(*p >= 'a' && *p <= 'z') && !(*p >= 'A' && *p <= 'Z') && !(*p >= '0' && *p <= '9')) {
+				*p = '_';
+			}
+		}
+		stage->pid = pid;
+		stage->stamp = stamp;
+		trace->count++;
+
+		dbus_message_iter_next(&array_iter);
+	}
+	trace->id = id ? id : 1;
+
+	// 3.ʱ䣨δʱȡǰʱ䣩
+	unsigned long long* arrival = trace_slot >= 0 ? dbus_message_get_data(message, trace_slot) : NULL;
+	int count = trace->count;
+	dbus_trace_mark(trace, "bus");
+	if (arrival && trace->count > count) {
+		trace->stages[trace->count - 1].stamp = *arrival;
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////
+// ܣϲԷصĽ׶Σ̼¼Ľ׶Σʱ
+// 룺ټ¼Էټ¼
+// ϲĸټ¼
+// أ
+////////////////////////////////////////////////////////////
+void dbus_trace_merge(DBUS_TRACE* trace, const DBUS_TRACE* remote)
+{
+	unsigned int pid = (unsigned int)getpid();
+	int i, j;
+
+	if (!trace->id || remote->id != trace->id) {
+		return;
+	}
+
+	for (i = 0; i < remote->count && trace->count < DBUS_TRACE_STAGE_MAX; i++) {
+		if (remote->stages[i].pid == pid) {
+			continue;
+		}
+
+		// 
+		DBUS_TRACE_STAGE stage = remote->stages[i];
+		for (j = trace->count; j > 0 && trace->stages[j - 1].stamp > stage.stamp; j--) {
+			trace->stages[j] = trace->stages[j - 1];
+		}
+		trace->stages[j] = stage;
+		trace->count++;
+	}
+}
+
+////////////////////////////////////////////////////////////
+// ܣټ¼дļÿ׶һ¼һ׶ν׶ν
+// 룺ټ¼ϢԱ
+// 
+// أ
+////////////////////////////////////////////////////////////
+void dbus_trace_write(const DBUS_TRACE* trace, const char* member)
+{
+	int i;
+
+	if (!trace_file || !trace->id) {
+		return;
+	}
+
+	for (i = 1; i < trace->count; i++) {
+		const DBUS_TRACE_STAGE* prev = &trace->stages[i - 1];
+		const DBUS_TRACE_STAGE* stage = &trace->stages[i];
+		long long duration = (long long)(stage->stamp - prev->stamp);
+
+		fprintf(trace_file, "%s{\"name\":\"%s\",\"cat\":\"dbus\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+			"\"pid\":%u,\"tid\":%u,\"args\":{\"trace_id\":\"%016llx\",\"member\":\"%s\"}}",
+			trace_events++ ? ",\n" : "", stage->name, prev->stamp / 1000.0, (duration > 0 ? duration : 0) / 1000.0,
+			stage->pid, stage->pid, trace->id, member);
+	}
+	fflush(trace_file);
+}
@@ -1,5 +1,7 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "dbus.h"
 
 
@@ -12,18 +14,57 @@
 static void usage() 
 { 
 	printf("Usage: ./demo [OPTIONS] [PARAMETERS]\n");
-	printf("\treceive\n");
+	printf("\treceive [options]\n");
 	printf("\t\t-- listen, wait a signal or a method call\n");
+	printf("\t\t-- options: -t file  write traced messages to a Chrome trace JSON file\n");
+	printf("\t\t--          -s dir   accept file streams into dir (any peer on the bus can write\n");
+	printf("\t\t--                   files there, so use a dedicated directory; off by default)\n");
+	printf("\t\t--          -r rate  admit at most rate calls per second from each sender, reject the rest\n");
+	printf("\t\t--          -b burst calls a sender may make at once under -r (default: rate)\n");
+	printf("\t\t-- SIGTERM/SIGINT releases the name, finishes received messages and exits\n");
 	printf("\t\t-- ./demo receive\n");
+	printf("\t\t-- ./demo receive -s /var/tmp/incoming\n");
+	printf("\t\t-- ./demo receive -r 100 -b 20\n");
 	printf("\n");
-	printf("\tsend [mode] [type] [value]\n");
-	printf("\t\t-- send a signal or call a method\n");
-	printf("\t\t-- mode:  SIGNAL | METHOD\n");
+	printf("\tagent [options]\n");
+	printf("\t\t-- keep one bus connection open and send requests from the control socket\n");
+	printf("\t\t-- options: -a path  control socket (default $XDG_RUNTIME_DIR/%s)\n", DBUS_AGENT_NAME);
+	printf("\t\t--          -n       do not request the sender bus name\n");
+	printf("\t\t-- SIGTERM/SIGINT finishes accepted requests and exits\n");
+	printf("\t\t-- ./demo agent\n");
+	printf("\n");
+	printf("\tsend [options] [mode] [type] [value]\n");
+	printf("\tsend [options] FILE [path]\n");
+	printf("\t\t-- send a signal or call a method, or stream a file in %d KB chunks\n", DBUS_STREAM_CHUNK / 1024);
+	printf("\t\t-- (a receiver started with -s dir saves it as dir/<file name>)\n");
+	printf("\t\t-- options: -z threshold  compress STRING values of at least threshold bytes (LZ4=1 build)\n");
+	printf("\t\t--          -t file       trace send, bus, handler and reply stages into a Chrome trace JSON file\n");
+	printf("\t\t--          -n            do not request the sender bus name\n");
+	printf("\t\t--          --via-agent   send through a running agent instead of a new bus connection\n");
+	printf("\t\t--          -a path       agent control socket (default $XDG_RUNTIME_DIR/%s)\n", DBUS_AGENT_NAME);
+	printf("\t\t--          -c count      send the signal count times over one connection\n");
+	printf("\t\t--          --shm         open a shared memory channel to the receiver first (SIGNAL only)\n");
+	printf("\t\t--          --batch       pack up to %d signals into one envelope message (SIGNAL only)\n", DBUS_BATCH_EVENTS);
+	printf("\t\t-- mode:  SIGNAL | METHOD | FILE\n");
 	printf("\t\t-- type:  STRING | INT32\n");
 	printf("\t-- value: string or number\n");
 	printf("\n");
 	printf("\t\t-- ./demo send SIGNAL STRING hello\n");
 	printf("\t\t-- ./demo send METHOD INT32 99\n");
+	printf("\t\t-- ./demo send -z 256 SIGNAL STRING \"$(cat big.json)\"\n");
+	printf("\t\t-- ./demo send -t trace.json METHOD STRING hello\n");
+	printf("\t\t-- ./demo send --via-agent METHOD STRING hello\n");
+	printf("\t\t-- ./demo send FILE firmware.img\n");
+	printf("\t\t-- ./demo send --shm -c 100000 SIGNAL INT32 1\n");
+	printf("\t\t-- ./demo send --batch -c 10000 SIGNAL STRING hello\n");
+	printf("\n");
+	printf("\tfuzz [options]\n");
+	printf("\t\t-- send random and malformed messages to the receiver at maximum rate,\n");
+	printf("\t\t-- report throughput, RSS and fds every second, fail on crash, leak or slowdown\n");
+	printf("\t\t-- options: -d seconds  duration (default 60, at least 4)\n");
+	printf("\t\t--          -s seed     random seed (default: time)\n");
+	printf("\t\t--          -p pid      receiver process to sample\n");
+	printf("\t\t-- ./demo fuzz -d 30 -p $(pidof demo)\n");
 	printf("\n");
 }
 
@@ -36,50 +77,232 @@ void main(int argc, char *argv[])
 
 	if (!strcmp(argv[1], "receive")) {
 
+		double rate = 0;
+		double burst = 0;
+
+		int arg = 2;
+		while (arg + 1 < argc) {
+			if (!strcmp(argv[arg], "-t")) {
+				if (dbus_trace_open(argv[arg + 1])) {
+					return;
+				}
+			}
+			else if (!strcmp(argv[arg], "-s")) {
+				if (dbus_set_stream_dir(argv[arg + 1])) {
+					return;
+				}
+			}
+			else if (!strcmp(argv[arg], "-r")) {
+				rate = atof(argv[arg + 1]);
+			}
+			else if (!strcmp(argv[arg], "-b")) {
+				burst = atof(argv[arg + 1]);
+			}
+			else {
+				break;
+			}
+			arg += 2;
+		}
+		if (arg != argc) {
+			usage();
+			return;
+		}
+		if (rate && dbus_set_rate_limit(rate, burst ? burst : rate)) {
+			return;
+		}
+
 		DBUS_APPLICATION self;
 		self.bus_name = DBUS_RECEIVER_BUS_NAME;
 		self.object_path = DBUS_RECEIVER_PATH;
 		self.interface_name = DBUS_RECEIVER_INTERFACE;
 		dbus_receive(self);
+		dbus_trace_close();
+
+		if (rate) {
+			DBUS_LIMIT_STATS stats;
+			dbus_get_limit_stats(&stats);
+			printf("Accepted %llu, Throttled %llu, Overflowed %llu\n", stats.accepted, stats.throttled, stats.overflowed);
+		}
 	}
-	else if (!strcmp(argv[1], "send")) {
+	else if (!strcmp(argv[1], "agent")) {
 
-		if (argc < 5) {
-			usage();
-			return;
+		DBUS_APPLICATION self;
+		self.bus_name = DBUS_SENDER_BUS_NAME;
+		self.object_path = DBUS_RECEIVER_PATH;
+		self.interface_name = DBUS_RECEIVER_INTERFACE;
+		const char* path = NULL;
+
+		int arg = 2;
+		while (arg < argc) {
+			if (!strcmp(argv[arg], "-a") && arg + 1 < argc) {
+				path = argv[arg + 1];
+				arg += 2;
+			}
+			else if (!strcmp(argv[arg], "-n")) {
+				self.bus_name = NULL;
+				arg++;
+			}
+			else {
+				usage();
+				return;
+			}
 		}
 
+		dbus_agent_run(self, path);
+	}
+	else if (!strcmp(argv[1], "send")) {
+
 		DBUS_APPLICATION sender;
 		sender.bus_name = DBUS_SENDER_BUS_NAME;
+		const char* agent_path = NULL;
+		int via_agent = 0;
+		int count = 0;
+		int flags = 0;
+
+		int arg = 2;
+		while (arg < argc && argv[arg][0] == '-') {
+			if (!strcmp(argv[arg], "--via-agent")) {
+				via_agent = 1;
+				arg++;
+			}
+			else if (!strcmp(argv[arg], "-a") && arg + 1 < argc) {
+				agent_path = argv[arg + 1];
+				via_agent = 1;
+				arg += 2;
+			}
+			else if (!strcmp(argv[arg], "-n")) {
+				sender.bus_name = NULL;
+				arg++;
+			}
+			else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) {
+				count = atoi(argv[arg + 1]);
+				arg += 2;
+			}
+			else if (!strcmp(argv[arg], "--shm")) {
+				flags |= DBUS_SEND_FLAG_SHM;
+				arg++;
+			}
+			else if (!strcmp(argv[arg], "--batch")) {
+				flags |= DBUS_SEND_FLAG_BATCH;
+				arg++;
+			}
+			else if (!strcmp(argv[arg], "-z") && arg + 1 < argc) {
+				if (dbus_set_compression(atoi(argv[arg + 1]))) {
+					return;
+				}
+				arg += 2;
+			}
+			else if (!strcmp(argv[arg], "-t") && arg + 1 < argc) {
+				if (dbus_trace_open(argv[arg + 1])) {
+					return;
+				}
+				arg += 2;
+			}
+			else {
+				usage();
+				return;
+			}
+		}
 
 		DBUS_APPLICATION receiver;
 		receiver.bus_name = DBUS_RECEIVER_BUS_NAME;
 		receiver.object_path = DBUS_RECEIVER_PATH;
 		receiver.interface_name = DBUS_RECEIVER_INTERFACE;
+
+		if (argc - arg == 2 && !strcasecmp(argv[arg], "FILE")) {
+			dbus_send_stream(sender, receiver, argv[arg + 1]);
+			return;
+		}
+		if (argc - arg < 3) {
+			usage();
+			return;
+		}
 		
 		DBUS_DATA data;
-		if (!strcasecmp(argv[3], "STRING")) {
+		if (!strcasecmp(argv[arg + 1], "STRING")) {
 			data.type = DBUS_DATA_TYPE_STRING;
 		}
-		else if (!strcasecmp(argv[3], "INT32")) {
+		else if (!strcasecmp(argv[arg + 1], "INT32")) {
 			data.type = DBUS_DATA_TYPE_INT32;
 		}
 		else {
 			usage();
 			return;
 		}
-		data.value = argv[4];
+		data.value = argv[arg + 2];
 
-		if (!strcasecmp(argv[2], "SIGNAL")) {
+		if ((count || flags) && (via_agent || strcasecmp(argv[arg], "SIGNAL"))) {
+			usage();
+			return;
+		}
+
+		if (!strcasecmp(argv[arg], "SIGNAL")) {
 			receiver.member_name = DBUS_MEMBER_SIGNAL;
-			dbus_send_signal(sender, receiver, data);
+			if (count || flags) {
+				dbus_send_signals(sender, receiver, data, count ? count : 1, flags);
+			}
+			else if (via_agent) {
+				dbus_agent_send_signal(agent_path, receiver, data);
+			}
+			else {
+				dbus_send_signal(sender, receiver, data);
+			}
 		}
-		else if (!strcasecmp(argv[2], "METHOD")) {
+		else if (!strcasecmp(argv[arg], "METHOD")) {
 			receiver.member_name = DBUS_MEMBER_METHOD;
-			dbus_send_method_call(sender, receiver, data);
+			if (via_agent) {
+				dbus_agent_send_method_call(agent_path, receiver, data);
+			}
+			else {
+				dbus_send_method_call(sender, receiver, data);
+			}
 		}
 		else {
 			usage();
+			return;
+		}
+
+		dbus_trace_close();
+
+		DBUS_COMPRESS_STATS stats;
+		dbus_get_compression_stats(&stats);
+		if (stats.compressed) {
+			printf("Compressed %llu -> %llu bytes (ratio %.2f)\n", stats.raw_bytes, stats.compressed_bytes, stats.ratio);
+		}
+	}
+	else if (!strcmp(argv[1], "fuzz")) {
+
+		int seconds = 60;
+		unsigned int seed = (unsigned int)time(NULL);
+		int target = 0;
+
+		int arg = 2;
+		while (arg + 1 < argc) {
+			if (!strcmp(argv[arg], "-d")) {
+				seconds = atoi(argv[arg + 1]);
+			}
+			else if (!strcmp(argv[arg], "-s")) {
+				seed = (unsigned int)strtoul(argv[arg + 1], NULL, 0);
+			}
+			else if (!strcmp(argv[arg], "-p")) {
+				target = atoi(argv[arg + 1]);
+			}
+			else {
+				break;
+			}
+			arg += 2;
+		}
+		if (arg != argc) {
+			usage();
+			return;
+		}
+
+		DBUS_APPLICATION receiver;
+		receiver.bus_name = DBUS_RECEIVER_BUS_NAME;
+		receiver.object_path = DBUS_RECEIVER_PATH;
+		receiver.interface_name = DBUS_RECEIVER_INTERFACE;
+		if (dbus_fuzz_run(receiver, seconds, seed, target)) {
+			exit(1);
 		}
 	}
 	else {